@@ -0,0 +1,449 @@
+// 编解码内核的微基准测试
+// 在熵可控的合成语料上测量各热点路径的吞吐（MB/s）和每字节耗时（ns/byte），结果以JSON输出，
+// 便于比较不同构建、发现性能回退。
+//
+// 用法: bench [--size <MiB>] [--min-time <秒>] [--filter <名称子串>]
+
+#include "Histogram.hpp"
+#include "HuffmanTree.hpp"
+#include "HuffmanDecoder.hpp"
+#include "TreeSerializer.hpp"
+#include "BitStream.hpp"
+#include "VarInt.hpp"
+#include "BufferCompressor.hpp"
+#include "Crc32c.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 防止被测代码的结果被编译器优化掉
+volatile uint64_t sink;
+
+struct Corpus {
+    std::string name;
+    std::string data;
+};
+
+struct Result {
+    std::string name;
+    std::string corpus;
+    uint64_t bytes;      // 每次运行处理的字节数
+    double seconds;      // 最快一次运行的耗时
+    int runs;
+};
+
+// ---- 合成语料 ----
+
+// 均匀随机字节（约8 bit/字节，几乎不可压缩）
+std::string makeUniform(size_t size, std::mt19937_64& rng) {
+    std::string data(size, '\0');
+    for (auto& ch : data) ch = static_cast<char>(rng());
+    return data;
+}
+
+// 几何分布的偏斜字节（少数字节值占绝大多数，约2 bit/字节）
+std::string makeSkewed(size_t size, std::mt19937_64& rng) {
+    std::geometric_distribution<int> dist(0.3);
+    std::string data(size, '\0');
+    for (auto& ch : data) ch = static_cast<char>(std::min(dist(rng), 255));
+    return data;
+}
+
+// 类文本：按Zipf分布从随机词表中取词，以空格、标点和换行分隔
+std::string makeText(size_t size, std::mt19937_64& rng) {
+    const int vocabularySize = 4096;
+    std::vector<std::string> words(vocabularySize);
+    std::uniform_int_distribution<int> wordLength(1, 10);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    for (auto& word : words) {
+        int length = wordLength(rng);
+        for (int i = 0; i < length; i++) word.push_back(static_cast<char>(letter(rng)));
+    }
+
+    std::vector<double> weights(vocabularySize);
+    for (int i = 0; i < vocabularySize; i++) weights[i] = 1.0 / (i + 1);
+    std::discrete_distribution<int> pick(weights.begin(), weights.end());
+
+    std::string data;
+    data.reserve(size + 16);
+    int column = 0;
+    while (data.size() < size) {
+        const std::string& word = words[pick(rng)];
+        data += word;
+        column += static_cast<int>(word.size()) + 1;
+        if (rng() % 12 == 0) data.push_back(rng() % 2 ? ',' : '.');
+        if (column > 72) {
+            data.push_back('\n');
+            column = 0;
+        } else {
+            data.push_back(' ');
+        }
+    }
+    data.resize(size);
+    return data;
+}
+
+// 类二进制：零填充区、小整数表、指令样的随机字节和ASCII字符串交替出现
+std::string makeBinary(size_t size, std::mt19937_64& rng) {
+    std::string data;
+    data.reserve(size + 4096);
+    std::geometric_distribution<int> small(0.2);
+    while (data.size() < size) {
+        size_t run = 64 + rng() % 2048;
+        switch (rng() % 4) {
+        case 0:  // 零填充
+            data.append(run, '\0');
+            break;
+        case 1:  // 小端32位小整数
+            for (size_t i = 0; i < run / 4; i++) {
+                uint32_t value = static_cast<uint32_t>(small(rng));
+                for (int b = 0; b < 4; b++) data.push_back(static_cast<char>(value >> (8 * b)));
+            }
+            break;
+        case 2:  // 偏向常见操作码的字节
+            for (size_t i = 0; i < run; i++) {
+                static const unsigned char opcodes[] = {0x48, 0x89, 0x8b, 0xe8, 0x0f, 0x85, 0xc3, 0xff};
+                data.push_back(static_cast<char>(rng() % 3 ? opcodes[rng() % 8] : rng()));
+            }
+            break;
+        default:  // 符号名字符串
+            for (size_t i = 0; i < run; i++) {
+                data.push_back(static_cast<char>(i % 16 == 15 ? '\0' : 'a' + rng() % 26));
+            }
+            break;
+        }
+    }
+    data.resize(size);
+    return data;
+}
+
+// ---- 计时 ----
+
+// 至少运行 minTime 秒（且至少3次），返回最快一次的耗时
+double measure(const std::function<void()>& body, double minTime, int& runs) {
+    using Clock = std::chrono::steady_clock;
+    double best = 1e300;
+    double total = 0;
+    runs = 0;
+    while (total < minTime || runs < 3) {
+        auto start = Clock::now();
+        body();
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        best = std::min(best, elapsed);
+        total += elapsed;
+        runs++;
+    }
+    return best;
+}
+
+// ---- 正确性 ----
+
+// 内存接口的往返检查：多种长度（含空输入、单字节、跨块）压缩后经两种 decompress 重载还原，
+// 并核对 decompressedSize；计时之前运行，不一致时基准测试以非零状态退出
+bool checkBufferRoundTrip(const Corpus& corpus) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(corpus.data.data());
+    const size_t lengths[] = {0, 1, 100, 512, 4096, 64 * 1024, BlockCodec::kBlockSize + 12345, corpus.data.size()};
+    BufferCompressor::Context context;
+    std::vector<uint8_t> packed, restored;
+    for (size_t length : lengths) {
+        length = std::min(length, corpus.data.size());
+        uint64_t rawSize = 0;
+        size_t written = 0;
+        std::vector<uint8_t> direct(length);
+        bool ok = BufferCompressor::compress(bytes, length, packed, context) &&
+                  BufferCompressor::decompressedSize(packed.data(), packed.size(), rawSize) && rawSize == length &&
+                  BufferCompressor::decompress(packed.data(), packed.size(), restored, context) &&
+                  restored.size() == length && std::memcmp(restored.data(), bytes, length) == 0 &&
+                  BufferCompressor::decompress(packed.data(), packed.size(), direct.data(), direct.size(),
+                                               written, context) &&
+                  written == length && std::memcmp(direct.data(), bytes, length) == 0;
+        if (!ok) {
+            std::cerr << "错误：内存接口往返不一致（" << corpus.name << "，" << length << " 字节）" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string out;
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') out.push_back('\\');
+        out.push_back(ch);
+    }
+    return out;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t sizeMiB = 8;
+    double minTime = 0.3;
+    std::string filter;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) {
+            sizeMiB = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            minTime = std::atof(argv[++i]);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            std::cerr << "用法: " << argv[0] << " [--size <MiB>] [--min-time <秒>] [--filter <名称子串>]" << std::endl;
+            return 1;
+        }
+    }
+    const size_t size = sizeMiB << 20;
+
+    std::mt19937_64 rng(20240601);
+    std::vector<Corpus> corpora = {
+        {"uniform", makeUniform(size, rng)},
+        {"skewed", makeSkewed(size, rng)},
+        {"text", makeText(size, rng)},
+        {"binary", makeBinary(size, rng)},
+    };
+
+    for (const auto& corpus : corpora) {
+        if (!checkBufferRoundTrip(corpus)) return 1;
+    }
+
+    std::vector<Result> results;
+    auto run = [&](const std::string& name, const Corpus& corpus, uint64_t bytes, const std::function<void()>& body) {
+        if (!filter.empty() && name.find(filter) == std::string::npos) return;
+        std::cerr << "  " << name << " / " << corpus.name << std::endl;
+        int runs = 0;
+        double seconds = measure(body, minTime, runs);
+        results.push_back({name, corpus.name, bytes, seconds, runs});
+    };
+
+    std::string tempPath = (std::filesystem::temp_directory_path() / "easycompress_bench.bin").string();
+
+    for (const auto& corpus : corpora) {
+        const char* data = corpus.data.data();
+        const size_t n = corpus.data.size();
+
+        // 直方图
+        run("histogram", corpus, n, [&] {
+            sink = Histogram::count(data, n)[0];
+        });
+
+        Histogram::Counts counts = Histogram::count(data, n);
+
+        // 建树和规范码表（按字节计吞吐无意义，这里按一次建树计 256 字节的直方图输入）
+        run("tree_build", corpus, 256 * sizeof(uint64_t), [&] {
+            HuffmanTree tree;
+            tree.buildFromCounts(counts);
+            sink = tree.getCodeLengths()[0];
+        });
+        run("tree_build_limited11", corpus, 256 * sizeof(uint64_t), [&] {
+            HuffmanTree tree;
+            tree.buildFromCounts(counts, 11);
+            sink = tree.getCodeLengths()[0];
+        });
+
+        HuffmanTree tree;
+        tree.buildFromCounts(counts);
+
+        // 编码：打包位写入器和旧的'0'/'1'字符串接口
+        PackedBitWriter writer;
+        run("encode_packed", corpus, n, [&] {
+            writer.reset();
+            tree.encodeTo(data, n, writer);
+            writer.flush();
+            sink = writer.bitsWritten();
+        });
+        const size_t stringSize = std::min<size_t>(n, 1 << 20);  // 字符串接口每字节约占8倍内存，只测1 MiB
+        std::string sample = corpus.data.substr(0, stringSize);
+        run("encode_string", corpus, stringSize, [&] {
+            sink = tree.encode(sample).size();
+        });
+
+        // 解码：查表解码器和 decodeWithTree（从'0'/'1'字符串）
+        writer.reset();
+        tree.encodeTo(data, n, writer);
+        writer.flush();
+        std::vector<uint8_t> encoded = writer.getBytes();
+        uint64_t bitCount = writer.bitsWritten();
+
+        HuffmanDecoder decoder;
+        decoder.buildFromLengths(tree.getCodeLengths());
+        std::string decoded;
+        run("decode_table", corpus, n, [&] {
+            decoded.clear();
+            decoder.decode(encoded, bitCount, decoded);
+            sink = decoded.size();
+        });
+
+        // 4条交错子流：语料均分成4段分别编码，共用同一张解码表
+        const size_t kStreams = 4;
+        const size_t segment = (n + kStreams - 1) / kStreams;
+        std::vector<std::vector<uint8_t>> streamData(kStreams);
+        uint64_t streamBits[kStreams];
+        size_t streamSymbols[kStreams];
+        const uint8_t* streamPointers[kStreams];
+        for (size_t s = 0; s < kStreams; s++) {
+            size_t begin = std::min(n, s * segment);
+            size_t end = std::min(n, begin + segment);
+            PackedBitWriter streamWriter;
+            tree.encodeTo(data + begin, end - begin, streamWriter);
+            streamWriter.flush();
+            streamBits[s] = streamWriter.bitsWritten();
+            streamSymbols[s] = end - begin;
+            streamData[s] = streamWriter.takeBytes();
+            streamPointers[s] = streamData[s].data();
+        }
+        run("decode_streams4", corpus, n, [&] {
+            decoded.resize(n);
+            char* targets[kStreams];
+            for (size_t s = 0; s < kStreams; s++) targets[s] = &decoded[0] + std::min(n, s * segment);
+            decoder.decodeStreams(streamPointers, streamBits, streamSymbols, kStreams, targets);
+            sink = decoded.size();
+        });
+
+        HuffmanTree shapeTree;
+        shapeTree.buildFromFrequencies(Histogram::toFrequencies(counts));
+        shapeTree.generateCodeTable();
+        std::string bitString = shapeTree.encode(sample);
+        run("decode_with_tree", corpus, stringSize, [&] {
+            sink = HuffmanTree::decodeWithTree(shapeTree.getNodes(), bitString).size();
+        });
+
+        // 码表序列化往返：规范码长表（内存）和旧的树结构（文件流）
+        run("serialize_lengths_roundtrip", corpus, 256, [&] {
+            PackedBitWriter headerWriter;
+            TreeSerializer::serializeLengths(tree.getCodeLengths(), headerWriter);
+            headerWriter.flush();
+            PackedBitReader headerReader(headerWriter.getBytes().data(), headerWriter.getBytes().size());
+            CanonicalCode::Lengths lengths;
+            TreeSerializer::deserializeLengths(headerReader, lengths);
+            sink = lengths[0];
+        });
+        run("serialize_tree_roundtrip", corpus, 256, [&] {
+            {
+                std::ofstream out(tempPath, std::ios::binary);
+                BitWriter treeWriter(out);
+                TreeSerializer::serialize(shapeTree.getNodes(), treeWriter);
+            }
+            std::ifstream in(tempPath, std::ios::binary);
+            BitReader treeReader(in);
+            HuffmanNodeArena nodes;
+            TreeSerializer::deserialize(treeReader, nodes);
+            sink = nodes.size();
+        });
+
+        // 逐位的流式 BitWriter/BitReader（旧格式头部使用）
+        const size_t bitBytes = std::min<size_t>(n, 1 << 20);
+        run("bitwriter_stream", corpus, bitBytes, [&] {
+            std::ofstream out(tempPath, std::ios::binary);
+            BitWriter bitWriter(out);
+            for (size_t i = 0; i < bitBytes; i++) {
+                bitWriter.writeByte(static_cast<unsigned char>(data[i]));
+            }
+        });
+        {
+            std::ofstream out(tempPath, std::ios::binary);
+            out.write(data, bitBytes);
+        }
+        run("bitreader_stream", corpus, bitBytes, [&] {
+            std::ifstream in(tempPath, std::ios::binary);
+            BitReader bitReader(in);
+            uint64_t sum = 0;
+            for (size_t i = 0; i < bitBytes; i++) {
+                sum += static_cast<uint64_t>(bitReader.readByte());
+            }
+            sink = sum;
+        });
+
+        // VarInt：把语料每4字节当作一个整数（按语料的字节分布决定数值大小）
+        std::vector<uint32_t> values(n / 4);
+        std::memcpy(values.data(), data, values.size() * 4);
+        for (auto& value : values) value >>= (value & 31);
+        std::vector<uint8_t> varints;
+        run("varint_encode", corpus, values.size() * 4, [&] {
+            varints.clear();
+            for (uint32_t value : values) VarInt::append(varints, value);
+            sink = varints.size();
+        });
+        varints.clear();
+        for (uint32_t value : values) VarInt::append(varints, value);
+        run("varint_decode", corpus, values.size() * 4, [&] {
+            const uint8_t* p = varints.data();
+            const uint8_t* end = p + varints.size();
+            uint64_t sum = 0;
+            uint32_t value;
+            while (p < end && VarInt::decode(p, end, value)) sum += value;
+            sink = sum;
+        });
+
+        // 块校验和：运行时选择的实现（支持 SSE4.2 时为硬件指令）与查表实现
+        run("crc32c", corpus, n, [&] {
+            sink = Crc32c::of(data, n);
+        });
+        run("crc32c_software", corpus, n, [&] {
+            sink = Crc32c::ofSoftware(data, n);
+        });
+
+        // 内存接口：按64 KiB一条消息反复压缩/解压，复用同一个 Context
+        const size_t messageSize = std::min<size_t>(n, 64 * 1024);
+        const size_t messages = n / messageSize;
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        BufferCompressor::Context context;
+        std::vector<uint8_t> compressed(BufferCompressor::compressBound(messageSize));
+        std::vector<uint8_t> restored(messageSize);
+        size_t written = 0;
+        run("buffer_compress", corpus, messages * messageSize, [&] {
+            for (size_t i = 0; i < messages; i++) {
+                BufferCompressor::compress(bytes + i * messageSize, messageSize, compressed.data(),
+                                           compressed.size(), written, context);
+            }
+            sink = written;
+        });
+        // 小消息（512字节，如单条 JSON 记录）：码长表的开销占主要部分，可用内置静态表
+        const size_t smallSize = std::min<size_t>(n, 512);
+        const size_t smallMessages = std::min<size_t>(n / smallSize, 4096);
+        run("buffer_compress_small", corpus, smallMessages * smallSize, [&] {
+            for (size_t i = 0; i < smallMessages; i++) {
+                BufferCompressor::compress(bytes + i * smallSize, smallSize, compressed.data(),
+                                           compressed.size(), written, context);
+            }
+            sink = written;
+        });
+        BufferCompressor::compress(bytes, messageSize, compressed.data(), compressed.size(), written, context);
+        const size_t compressedSize = written;
+        run("buffer_decompress", corpus, messageSize, [&] {
+            BufferCompressor::decompress(compressed.data(), compressedSize, restored.data(), restored.size(),
+                                         written, context);
+            sink = written;
+        });
+    }
+    std::filesystem::remove(tempPath);
+
+    // 输出JSON
+    std::cout << "{\n  \"size_bytes\": " << size << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        double mbPerSecond = r.bytes / r.seconds / 1e6;
+        double nsPerByte = r.seconds * 1e9 / r.bytes;
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "    {\"name\": \"%s\", \"corpus\": \"%s\", \"bytes\": %llu, \"seconds\": %.6f, "
+                      "\"runs\": %d, \"mb_per_s\": %.2f, \"ns_per_byte\": %.4f}%s\n",
+                      jsonEscape(r.name).c_str(), jsonEscape(r.corpus).c_str(),
+                      static_cast<unsigned long long>(r.bytes), r.seconds, r.runs, mbPerSecond, nsPerByte,
+                      i + 1 < results.size() ? "," : "");
+        std::cout << line;
+    }
+    std::cout << "  ]\n}" << std::endl;
+    return 0;
+}
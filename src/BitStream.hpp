@@ -1,5 +1,9 @@
 #pragma once
 #include <fstream>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
 
 // 位级写入器
 class BitWriter {
@@ -84,3 +88,217 @@ public:
         return byte;
     }
 };
+
+
+// 内存位读取器：从打包好的字节中按MSB优先顺序取位，64位缓冲一次补充多个字节
+class PackedBitReader {
+private:
+    const uint8_t* begin;
+    const uint8_t* cur;
+    const uint8_t* end;
+    uint64_t buffer;  // 左对齐的待消费位
+    int bitCount;     // buffer中有效的位数
+
+    static uint64_t loadBigEndian64(const uint8_t* p) {
+        return (uint64_t(p[0]) << 56) | (uint64_t(p[1]) << 48) |
+               (uint64_t(p[2]) << 40) | (uint64_t(p[3]) << 32) |
+               (uint64_t(p[4]) << 24) | (uint64_t(p[5]) << 16) |
+               (uint64_t(p[6]) << 8)  |  uint64_t(p[7]);
+    }
+
+public:
+    PackedBitReader(const uint8_t* data, size_t size)
+        : begin(data), cur(data), end(data + size), buffer(0), bitCount(0) {}
+
+    // 补充缓冲区：数据充足时保证至少有57位可用，数据末尾之后视为0
+    void refill() {
+        if (end - cur >= 8) {
+            // 一次装入8字节，只推进完整装入的字节数
+            buffer |= loadBigEndian64(cur) >> bitCount;
+            cur += (63 - bitCount) >> 3;
+            bitCount |= 56;
+        } else {
+            while (bitCount <= 56 && cur < end) {
+                buffer |= uint64_t(*cur++) << (56 - bitCount);
+                bitCount += 8;
+            }
+        }
+    }
+
+    // 无分支的补充：调用方保证当前位置之后至少还有8字节，补充后至少有57位可用
+    void refillFast() {
+        buffer |= loadBigEndian64(cur) >> bitCount;
+        cur += (63 - bitCount) >> 3;
+        bitCount |= 56;
+    }
+
+    // 缓冲区中可直接使用的位数
+    int available() const {
+        return bitCount;
+    }
+
+    // 查看接下来的n位（1 <= n <= 57），不消费
+    uint64_t peek(int n) const {
+        return buffer >> (64 - n);
+    }
+
+    // 消费n位（n不超过available()）
+    void consume(int n) {
+        buffer <<= n;
+        bitCount -= n;
+    }
+
+    // 读取n位（1 <= n <= 57）
+    uint64_t readBits(int n) {
+        if (bitCount < n) refill();
+        uint64_t value = peek(n);
+        consume(n);
+        return value;
+    }
+
+    // 读取一个位
+    int readBit() {
+        return static_cast<int>(readBits(1));
+    }
+
+    // 已消费的总位数
+    uint64_t bitsConsumed() const {
+        return uint64_t(cur - begin) * 8 - bitCount;
+    }
+};
+
+// 内存位写入器：64位累加器按MSB优先顺序收集位，凑满32位整字写入字节缓冲
+class PackedBitWriter {
+private:
+    std::vector<uint8_t> bytes;
+    uint64_t buffer;     // 左对齐的待写出位
+    int bitCount;        // buffer中的位数（写入后始终小于32）
+    uint64_t totalBits;  // 累计写入的位数
+
+    void emitWord() {
+        size_t n = bytes.size();
+        bytes.resize(n + 4);
+        bytes[n]     = static_cast<uint8_t>(buffer >> 56);
+        bytes[n + 1] = static_cast<uint8_t>(buffer >> 48);
+        bytes[n + 2] = static_cast<uint8_t>(buffer >> 40);
+        bytes[n + 3] = static_cast<uint8_t>(buffer >> 32);
+        buffer <<= 32;
+        bitCount -= 32;
+    }
+
+public:
+    PackedBitWriter() : buffer(0), bitCount(0), totalBits(0) {}
+
+    // 接着已有字节继续写（字节对齐），常用于在记录头之后直接写入编码数据
+    explicit PackedBitWriter(std::vector<uint8_t> initialBytes)
+        : bytes(std::move(initialBytes)), buffer(0), bitCount(0), totalBits(0) {}
+
+    // 写入code的低length位（length <= 64）
+    void writeBits(uint64_t code, int length) {
+        if (length > 32) {
+            writeBits(code >> 32, length - 32);
+            code &= 0xFFFFFFFFu;
+            length = 32;
+        }
+        if (length == 0) return;
+
+        buffer |= code << (64 - bitCount - length);
+        bitCount += length;
+        totalBits += length;
+        if (bitCount >= 32) {
+            emitWord();
+        }
+    }
+
+    // 写入一个位
+    void writeBit(int bit) {
+        writeBits(static_cast<uint64_t>(bit & 1), 1);
+    }
+
+    // 把剩余位补0对齐到字节写出
+    void flush() {
+        while (bitCount > 0) {
+            bytes.push_back(static_cast<uint8_t>(buffer >> 56));
+            buffer <<= 8;
+            bitCount = bitCount > 8 ? bitCount - 8 : 0;
+        }
+        buffer = 0;
+    }
+
+    uint64_t bitsWritten() const {
+        return totalBits;
+    }
+
+    // 已完整写出的字节
+    const std::vector<uint8_t>& getBytes() const {
+        return bytes;
+    }
+
+    // 取走已完整写出的字节（通常在flush之后调用）
+    std::vector<uint8_t> takeBytes() {
+        return std::move(bytes);
+    }
+
+    // 把已完整写出的字节写入流并清空，累加器中的零碎位保留
+    void drainTo(std::ostream& out) {
+        out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        bytes.clear();
+    }
+
+    // 清空全部状态以便复用（保留缓冲区容量）
+    void reset() {
+        bytes.clear();
+        buffer = 0;
+        bitCount = 0;
+        totalBits = 0;
+    }
+};
+
+// 写到调用方内存的位写入器：位序与 PackedBitWriter 相同，整字直接写到 cursor 处，不分配也不检查边界
+// 调用方须按编码位数预先算好字节数并保证空间足够
+class PackedBitSpanWriter {
+private:
+    uint8_t* cursor;
+    uint64_t buffer;  // 左对齐的待写出位
+    int bitCount;     // buffer中的位数（写入后始终小于32）
+
+public:
+    explicit PackedBitSpanWriter(uint8_t* out) : cursor(out), buffer(0), bitCount(0) {}
+
+    // 写入code的低length位（length <= 64）
+    void writeBits(uint64_t code, int length) {
+        if (length > 32) {
+            writeBits(code >> 32, length - 32);
+            code &= 0xFFFFFFFFu;
+            length = 32;
+        }
+        if (length == 0) return;
+
+        buffer |= code << (64 - bitCount - length);
+        bitCount += length;
+        if (bitCount >= 32) {
+            cursor[0] = static_cast<uint8_t>(buffer >> 56);
+            cursor[1] = static_cast<uint8_t>(buffer >> 48);
+            cursor[2] = static_cast<uint8_t>(buffer >> 40);
+            cursor[3] = static_cast<uint8_t>(buffer >> 32);
+            cursor += 4;
+            buffer <<= 32;
+            bitCount -= 32;
+        }
+    }
+
+    // 把剩余位补0对齐到字节写出
+    void flush() {
+        while (bitCount > 0) {
+            *cursor++ = static_cast<uint8_t>(buffer >> 56);
+            buffer <<= 8;
+            bitCount = bitCount > 8 ? bitCount - 8 : 0;
+        }
+        buffer = 0;
+    }
+
+    // 下一个要写的字节（flush 之后即已写出部分的末尾）
+    uint8_t* position() const {
+        return cursor;
+    }
+};
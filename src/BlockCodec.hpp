@@ -0,0 +1,484 @@
+#pragma once
+
+#include "HuffmanTree.hpp"
+#include "HuffmanDecoder.hpp"
+#include "TreeSerializer.hpp"
+#include "BitStream.hpp"
+#include "VarInt.hpp"
+#include "Histogram.hpp"
+#include "Stats.hpp"
+#include "Crc32c.hpp"
+#include "StaticTables.hpp"
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+
+// 块编解码：输入按固定大小切块，各块独立统计、独立编码
+// 块记录格式：
+//   1字节类型 | VarInt 原始大小 | VarInt 载荷字节数 | 载荷 | 4字节 CRC32C（原始数据的校验和，'f' 版本5起）
+//   哈夫曼块载荷：码长表（字节对齐）| VarInt 位数 | 编码数据
+//   复用块载荷：VarInt 位数 | 编码数据（沿用最近一个哈夫曼块的码长表）
+//   原样块载荷：原始字节
+//   多流哈夫曼块/多流复用块：把块均分成N段，各段用同一张表编码成独立的子流
+//     载荷：[码长表] | VarInt N | N个 VarInt 子流位数（跳转表）| 各子流数据（各自字节对齐）
+//     第s段为原始数据的 [s*L, min((s+1)*L, 原始大小))，L = ceil(原始大小/N)
+//   静态表块载荷：1字节表号 | VarInt 位数 | 编码数据（使用内置的码长表，见 StaticTables；'f' 版本6起）
+//   结束标记：单独一个类型字节 kEnd
+// 块索引（位于结束标记之后）：
+//   VarInt 块数 | 每块：1字节类型 | VarInt 记录字节数 | VarInt 位数 | VarInt 原始大小
+//   末尾8字节（小端）：索引的起始偏移
+class BlockCodec {
+public:
+    static constexpr size_t kBlockSize = 1 << 20;  // 默认块大小（1 MiB）
+    static constexpr size_t kMaxBlockSize = size_t(1) << 30;  // 块大小上限（1 GiB），解码时更大的长度字段视为损坏
+
+    enum BlockType : uint8_t {
+        kEnd = 0,
+        kHuffman = 1,
+        kStored = 2,
+        kRepeat = 3,
+        kHuffmanStreams = 4,
+        kRepeatStreams = 5,
+        kStatic = 6,
+    };
+
+    static constexpr int kMaxStreams = 16;                  // 子流数上限
+    static constexpr size_t kMinStreamBlockSize = 16 << 10;  // 小于这个大小的块只用单个流
+
+    // 一个块的分析结果：直方图、自己的码长表以及选定的块类型
+    struct BlockPlan {
+        std::array<uint64_t, 256> counts{};
+        CanonicalCode::Lengths lengths{};
+        std::vector<uint8_t> header;  // 序列化后的码长表
+        uint64_t ownBits = 0;         // 用自己的表编码后的位数
+        uint64_t repeatBits = 0;      // 用上一张表编码后的位数
+        BlockType type = kStored;
+        int streams = 1;              // 子流数，大于1时选用多流块类型
+        uint8_t staticId = 0;         // 编码位数最少的内置静态表
+        uint64_t staticBits = UINT64_MAX;  // 用这张静态表编码后的位数（不能使用静态表时为UINT64_MAX）
+        std::vector<std::array<uint64_t, 256>> streamCounts;  // 各段的直方图（多流时）
+    };
+
+    // 块索引项
+    struct IndexEntry {
+        uint8_t type = kStored;
+        uint64_t recordSize = 0;  // 整条块记录的字节数
+        uint64_t bitCount = 0;    // 编码数据的位数（原样块为0）
+        uint64_t rawSize = 0;     // 原始大小
+    };
+
+    static constexpr size_t kTrailerSize = 8;  // 索引偏移占用的字节数
+    static constexpr size_t kMaxHeaderSize = 512;  // 码长表序列化后的字节数上限
+    static constexpr size_t kChecksumSize = 4;     // 块记录末尾校验和的字节数
+
+private:
+    // 用给定码长表编码的总位数；块中有字符不在表内时返回UINT64_MAX
+    static uint64_t bitsWithTable(const std::array<uint64_t, 256>& counts, const CanonicalCode::Lengths& lengths) {
+        uint64_t bits = 0;
+        for (int symbol = 0; symbol < 256; symbol++) {
+            if (counts[symbol] == 0) continue;
+            if (lengths[symbol] == 0) return UINT64_MAX;
+            bits += counts[symbol] * lengths[symbol];
+        }
+        return bits;
+    }
+
+    static size_t dataSize(uint64_t bits) {
+        return VarInt::encodedSize(bits) + static_cast<size_t>((bits + 7) / 8);
+    }
+
+    // 第 stream 段在块内的起止位置
+    static void streamRange(size_t size, int streams, int stream, size_t& begin, size_t& end) {
+        size_t length = (size + streams - 1) / streams;
+        begin = std::min(size, length * stream);
+        end = std::min(size, begin + length);
+    }
+
+    // 编码数据部分的字节数：单流为位数加数据，多流为流数、跳转表和各子流数据
+    static size_t codedSize(const BlockPlan& plan, const CanonicalCode::Lengths& lengths, uint64_t bits) {
+        if (plan.streams == 1) return dataSize(bits);
+        size_t size = VarInt::encodedSize(plan.streams);
+        for (const auto& counts : plan.streamCounts) {
+            size += dataSize(bitsWithTable(counts, lengths));
+        }
+        return size;
+    }
+
+    static void putHeader(uint8_t*& p, BlockType type, size_t rawSize, size_t payloadSize) {
+        *p++ = type;
+        VarInt::put(p, rawSize);
+        VarInt::put(p, payloadSize);
+    }
+
+    // 按选定的类型编码后载荷的字节数
+    static size_t payloadSize(const BlockPlan& plan, size_t size, const CanonicalCode::Lengths* previous) {
+        switch (plan.type) {
+        case kStored: return size;
+        case kStatic: return 1 + dataSize(plan.staticBits);
+        case kHuffman:
+        case kHuffmanStreams: return plan.header.size() + codedSize(plan, plan.lengths, plan.ownBits);
+        default: return codedSize(plan, *previous, plan.repeatBits);
+        }
+    }
+
+public:
+    // 统计直方图并构建这个块自己的规范码长表（各块互不依赖，可并行）
+    // maxCodeLength 为码长上限，0表示不限制；streams 为子流数（块太小时按1处理）；
+    // stats 不为空时分别计入直方图和建表阶段
+    static void analyzeBlock(const char* data, size_t size, BlockPlan& plan, int maxCodeLength = 0,
+                             int streams = 1, Stats* stats = nullptr) {
+        {
+            Stats::Timer timer(stats, Stats::kHistogram);
+            plan.streams = size >= kMinStreamBlockSize ? std::max(1, std::min(streams, kMaxStreams)) : 1;
+            if (plan.streams == 1) {
+                plan.counts = Histogram::count(data, size);
+                plan.streamCounts.clear();
+            } else {
+                // 分段统计，总直方图由各段相加，仍然只读一遍数据
+                plan.counts.fill(0);
+                plan.streamCounts.resize(plan.streams);
+                for (int s = 0; s < plan.streams; s++) {
+                    size_t begin, end;
+                    streamRange(size, plan.streams, s, begin, end);
+                    plan.streamCounts[s] = Histogram::count(data + begin, end - begin);
+                    Histogram::merge(plan.counts, plan.streamCounts[s]);
+                }
+            }
+        }
+
+        Stats::Timer timer(stats, Stats::kTreeBuild);
+        HuffmanTree tree;
+        tree.buildFromCounts(plan.counts, maxCodeLength);
+        plan.lengths = tree.getCodeLengths();
+        plan.ownBits = bitsWithTable(plan.counts, plan.lengths);
+
+        PackedBitWriter headerWriter;
+        TreeSerializer::serializeLengths(plan.lengths, headerWriter);
+        headerWriter.flush();
+        plan.header = headerWriter.takeBytes();
+
+        // 单流块再估算各内置静态表的位数；码长上限低于静态表的码长时不使用
+        plan.staticBits = UINT64_MAX;
+        if (plan.streams == 1 && (maxCodeLength == 0 || maxCodeLength >= StaticTables::kMaxLength)) {
+            for (int id = 0; id < StaticTables::kCount; id++) {
+                uint64_t bits = bitsWithTable(plan.counts, StaticTables::kLengths[id]);
+                if (bits < plan.staticBits) {
+                    plan.staticBits = bits;
+                    plan.staticId = static_cast<uint8_t>(id);
+                }
+            }
+        }
+    }
+
+    // 块类型是否自带码长表 / 是否沿用之前的码长表
+    static bool hasOwnTable(uint8_t type) {
+        return type == kHuffman || type == kHuffmanStreams;
+    }
+
+    static bool usesPreviousTable(uint8_t type) {
+        return type == kRepeat || type == kRepeatStreams;
+    }
+
+    // 在自带表、内置静态表、复用上一张表和原样存储中选出载荷最小的一种
+    // previous 为最近一个哈夫曼块的码长表（没有时为nullptr）；静态表块不改变之后复用的表
+    // 只依赖块内容和之前的选择，结果与线程数无关
+    static void chooseType(BlockPlan& plan, size_t size, const CanonicalCode::Lengths* previous) {
+        size_t best = size;
+        plan.type = kStored;
+        if (size == 0) return;
+
+        size_t own = plan.header.size() + codedSize(plan, plan.lengths, plan.ownBits);
+        if (own < best) {
+            best = own;
+            plan.type = plan.streams > 1 ? kHuffmanStreams : kHuffman;
+        }
+
+        if (plan.staticBits != UINT64_MAX && 1 + dataSize(plan.staticBits) < best) {
+            best = 1 + dataSize(plan.staticBits);
+            plan.type = kStatic;
+        }
+
+        if (previous != nullptr) {
+            plan.repeatBits = bitsWithTable(plan.counts, *previous);
+            if (plan.repeatBits != UINT64_MAX && codedSize(plan, *previous, plan.repeatBits) <= best) {
+                plan.type = plan.streams > 1 ? kRepeatStreams : kRepeat;
+            }
+        }
+    }
+
+    // 按选定的类型编码后整条块记录（含末尾的校验和）的字节数，由块计划精确算出
+    static size_t recordSize(const BlockPlan& plan, size_t size, const CanonicalCode::Lengths* previous) {
+        size_t payload = payloadSize(plan, size, previous);
+        return 1 + VarInt::encodedSize(size) + VarInt::encodedSize(payload) + payload + kChecksumSize;
+    }
+
+    // 按选定的类型编码一个块，完整的块记录直接写到 out 处；out 处须有 recordSize 字节的空间
+    static void encodeBlockTo(const char* data, size_t size, const BlockPlan& plan,
+                              const CanonicalCode::Lengths* previous, uint8_t* out) {
+        uint8_t* p = out;
+        putHeader(p, plan.type, size, payloadSize(plan, size, previous));
+        if (plan.type == kStored) {
+            std::copy(data, data + size, p);
+            p += size;
+        } else if (plan.type == kStatic) {
+            *p++ = plan.staticId;
+            VarInt::put(p, plan.staticBits);
+            PackedBitSpanWriter writer(p);
+            StaticTables::encoder(plan.staticId).encodeTo(data, size, writer);
+            writer.flush();
+            p = writer.position();
+        } else {
+            const CanonicalCode::Lengths& lengths = usesPreviousTable(plan.type) ? *previous : plan.lengths;
+            HuffmanTree tree;
+            tree.buildFromCodeLengths(lengths);
+            if (hasOwnTable(plan.type)) {
+                p = std::copy(plan.header.begin(), plan.header.end(), p);
+            }
+            if (plan.streams == 1) {
+                VarInt::put(p, payloadBits(plan));
+            } else {
+                VarInt::put(p, plan.streams);
+                for (const auto& counts : plan.streamCounts) {
+                    VarInt::put(p, bitsWithTable(counts, lengths));
+                }
+            }
+
+            // 编码数据直接接在记录后面写入；多流时每段结束都补齐到字节
+            PackedBitSpanWriter writer(p);
+            for (int s = 0; s < plan.streams; s++) {
+                size_t begin, end;
+                streamRange(size, plan.streams, s, begin, end);
+                tree.encodeTo(data + begin, end - begin, writer);
+                writer.flush();
+            }
+            p = writer.position();
+        }
+        VarInt::putFixed32(p, Crc32c::of(data, size));
+    }
+
+    // 按选定的类型编码一个块，完整的块记录（含末尾的校验和）追加到record
+    static void encodeBlock(const char* data, size_t size, const BlockPlan& plan,
+                            const CanonicalCode::Lengths* previous, std::vector<uint8_t>& record) {
+        size_t start = record.size();
+        record.resize(start + recordSize(plan, size, previous));
+        encodeBlockTo(data, size, plan, previous, record.data() + start);
+    }
+
+    // 核对解码结果与块记录中的校验和
+    static bool verifyChecksum(const char* decoded, size_t size, uint32_t checksum) {
+        if (Crc32c::of(decoded, size) != checksum) {
+            std::cerr << "错误：块校验和不符，数据已损坏" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    static bool verifyChecksum(const std::string& decoded, uint32_t checksum) {
+        return verifyChecksum(decoded.data(), decoded.size(), checksum);
+    }
+
+    // 块记录中编码数据的位数（原样块为0）
+    static uint64_t payloadBits(const BlockPlan& plan) {
+        switch (plan.type) {
+        case kHuffman:
+        case kHuffmanStreams: return plan.ownBits;
+        case kRepeat:
+        case kRepeatStreams:  return plan.repeatBits;
+        case kStatic:         return plan.staticBits;
+        default:              return 0;
+        }
+    }
+
+    // 检查块记录头中的原始大小和载荷大小（载荷不会比原始数据大），超出块大小上限时报错
+    static bool checkSizes(uint64_t rawSize, uint64_t payloadSize) {
+        if (rawSize > kMaxBlockSize || payloadSize > kMaxBlockSize) {
+            std::cerr << "错误：块大小超出上限" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // 解析块记录头：类型、原始大小和载荷位置；available 为 record 处可读的字节数
+    static bool parseRecord(const uint8_t* record, size_t available, uint8_t& type, uint32_t& rawSize,
+                            const uint8_t*& payload, uint32_t& payloadSize) {
+        const uint8_t* p = record;
+        const uint8_t* end = record + available;
+        if (p >= end) return false;
+        type = *p++;
+        uint64_t wideRaw = 0, widePayload = 0;
+        if (!VarInt::decode(p, end, wideRaw) || !VarInt::decode(p, end, widePayload) ||
+            !checkSizes(wideRaw, widePayload)) {
+            return false;
+        }
+        rawSize = static_cast<uint32_t>(wideRaw);
+        payloadSize = static_cast<uint32_t>(widePayload);
+        payload = p;
+        return true;
+    }
+
+    // 读取哈夫曼块载荷开头的码长表，headerBytes 返回码长表占用的字节数
+    static bool readTable(const uint8_t* payload, size_t payloadSize,
+                          CanonicalCode::Lengths& lengths, size_t& headerBytes) {
+        PackedBitReader headerReader(payload, payloadSize);
+        if (!TreeSerializer::deserializeLengths(headerReader, lengths)) {
+            return false;
+        }
+        headerBytes = static_cast<size_t>((headerReader.bitsConsumed() + 7) / 8);
+        if (headerBytes > payloadSize) {
+            std::cerr << "错误：码长表不完整" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // 追加块索引和末尾的索引偏移
+    static void appendIndex(const std::vector<IndexEntry>& entries, uint64_t indexOffset, std::vector<uint8_t>& out) {
+        VarInt::append(out, entries.size());
+        for (const auto& entry : entries) {
+            out.push_back(entry.type);
+            VarInt::append(out, entry.recordSize);
+            VarInt::append(out, entry.bitCount);
+            VarInt::append(out, entry.rawSize);
+        }
+        VarInt::appendFixed64(out, indexOffset);
+    }
+
+    // 读取末尾的索引偏移
+    static uint64_t readIndexOffset(const uint8_t* trailer) {
+        uint64_t offset = 0;
+        VarInt::decodeFixed64(trailer, trailer + kTrailerSize, offset);
+        return offset;
+    }
+
+    // 解析块索引（不含末尾的索引偏移）
+    static bool parseIndex(const uint8_t* data, size_t size, std::vector<IndexEntry>& entries) {
+        const uint8_t* p = data;
+        const uint8_t* end = data + size;
+        uint64_t count = 0;
+        if (!VarInt::decode(p, end, count)) return false;
+
+        // 每个条目至少4字节，块数不可能超过剩余字节数
+        if (count > static_cast<uint64_t>(end - p) / 4) return false;
+        entries.clear();
+        entries.reserve(static_cast<size_t>(count));
+        for (uint64_t i = 0; i < count; i++) {
+            IndexEntry entry;
+            if (p >= end) return false;
+            entry.type = *p++;
+            if (!VarInt::decode(p, end, entry.recordSize) || !VarInt::decode(p, end, entry.bitCount) ||
+                !VarInt::decode(p, end, entry.rawSize)) {
+                return false;
+            }
+            entries.push_back(entry);
+        }
+        return p == end;
+    }
+
+    // 解码多流块的跳转表和各子流（p 指向流数），rawSize 字节写到 out
+    static bool decodeStreams(const uint8_t* p, const uint8_t* end, uint64_t rawSize,
+                              const HuffmanDecoder& table, char* out) {
+        uint64_t streams = 0;
+        if (!VarInt::decode(p, end, streams) || streams < 2 || streams > kMaxStreams) {
+            std::cerr << "错误：子流数无效" << std::endl;
+            return false;
+        }
+
+        std::array<uint64_t, kMaxStreams> bitCounts;
+        for (uint32_t s = 0; s < streams; s++) {
+            uint64_t bits = 0;
+            if (!VarInt::decode(p, end, bits) || bits > uint64_t(kMaxBlockSize) * 8) {
+                std::cerr << "错误：块数据不完整" << std::endl;
+                return false;
+            }
+            bitCounts[s] = bits;
+        }
+
+        // 由跳转表定位各子流，各段的输出位置由原始大小均分得到
+        std::array<const uint8_t*, kMaxStreams> data;
+        std::array<size_t, kMaxStreams> symbolCounts;
+        std::array<char*, kMaxStreams> targets;
+        for (uint32_t s = 0; s < streams; s++) {
+            uint64_t bytes = (bitCounts[s] + 7) / 8;
+            if (bytes > uint64_t(end - p)) {
+                std::cerr << "错误：块数据不完整" << std::endl;
+                return false;
+            }
+            data[s] = p;
+            p += bytes;
+
+            size_t begin, finish;
+            streamRange(rawSize, static_cast<int>(streams), static_cast<int>(s), begin, finish);
+            symbolCounts[s] = finish - begin;
+            targets[s] = out + begin;
+        }
+        return table.decodeStreams(data.data(), bitCounts.data(), symbolCounts.data(), streams, targets.data());
+    }
+
+    // 解码一个块的载荷，恰好 rawSize 字节直接写到 out 处（须有 rawSize 字节的空间）
+    // table 为当前码长表对应的解码器：哈夫曼块会替换它，复用块沿用它
+    static bool decodeBlockTo(uint8_t type, const uint8_t* payload, size_t payloadSize,
+                              uint64_t rawSize, HuffmanDecoder& table, char* out) {
+        if (type == kStored) {
+            if (payloadSize != rawSize) {
+                std::cerr << "错误：原样块大小不一致" << std::endl;
+                return false;
+            }
+            std::copy(payload, payload + payloadSize, out);
+            return true;
+        }
+
+        const uint8_t* p = payload;
+        const uint8_t* end = payload + payloadSize;
+        const HuffmanDecoder* decoder = &table;
+
+        if (type == kStatic) {
+            // 内置静态表，不影响之后复用的表
+            if (p >= end || *p >= StaticTables::kCount) {
+                std::cerr << "错误：静态表号无效" << std::endl;
+                return false;
+            }
+            decoder = &StaticTables::decoder(*p++);
+        } else if (hasOwnTable(type)) {
+            // 码长表
+            CanonicalCode::Lengths lengths;
+            size_t headerBytes = 0;
+            if (!readTable(payload, payloadSize, lengths, headerBytes)) {
+                return false;
+            }
+            table.buildFromLengths(lengths);
+            p += headerBytes;
+        } else if (usesPreviousTable(type)) {
+            if (table.empty()) {
+                std::cerr << "错误：复用块之前没有码长表" << std::endl;
+                return false;
+            }
+        } else {
+            std::cerr << "错误：未知的块类型 " << static_cast<int>(type) << std::endl;
+            return false;
+        }
+
+        if (type == kHuffmanStreams || type == kRepeatStreams) {
+            return decodeStreams(p, end, rawSize, table, out);
+        }
+
+        // 位数和编码数据
+        uint64_t bitCount = 0;
+        if (!VarInt::decode(p, end, bitCount) || bitCount > uint64_t(kMaxBlockSize) * 8 ||
+            (bitCount + 7) / 8 > uint64_t(end - p)) {
+            std::cerr << "错误：块数据不完整" << std::endl;
+            return false;
+        }
+
+        return decoder->decodeTo(p, bitCount, out, static_cast<size_t>(rawSize));
+    }
+
+    // 解码一个块的载荷，结果替换 out 的内容；反复用同一个 out 解码等大的块时不必重新分配和清零
+    static bool decodeBlock(uint8_t type, const uint8_t* payload, size_t payloadSize,
+                            uint64_t rawSize, HuffmanDecoder& table, std::string& out) {
+        out.resize(rawSize);
+        return decodeBlockTo(type, payload, payloadSize, rawSize, table, &out[0]);
+    }
+};
@@ -0,0 +1,233 @@
+#pragma once
+
+#include "BlockCodec.hpp"
+#include "FileCompressor.hpp"
+#include "HuffmanDecoder.hpp"
+#include "CompressOptions.hpp"
+#include "VarInt.hpp"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+// 内存缓冲区的压缩/解压，供嵌入到其他程序中使用，不读写文件
+// 输出与 FileCompressor 的 'f' 格式逐字节相同，两边可以互相解压
+// 每次调用在当前线程内逐块完成（不使用 options.threads），块记录直接编码到输出、块直接解码到输出，
+// 块计划、索引、解码表等中间状态放在 Context 中：
+// 同一个 Context 反复使用时只在数据变大时才重新分配；多个线程各用自己的 Context
+class BufferCompressor {
+public:
+    // 可重复使用的中间状态
+    class Context {
+    private:
+        friend class BufferCompressor;
+        BlockCodec::BlockPlan plan;
+        CanonicalCode::Lengths previous{};          // 最近一个哈夫曼块的码长表
+        std::vector<BlockCodec::IndexEntry> index;
+        std::vector<uint8_t> indexBytes;            // 序列化后的块索引
+        HuffmanDecoder table;
+    };
+
+    // 压缩 size 字节输入时输出的最大字节数：每块的载荷不会超过原样存储，
+    // 再加上块头、校验和、结束标记和块索引
+    static size_t compressBound(size_t size, size_t blockSize = BlockCodec::kBlockSize) {
+        size_t blocks = (size + blockSize - 1) / blockSize;
+        size_t recordHeader = 1 + 2 * VarInt::encodedSize(blockSize) + BlockCodec::kChecksumSize;
+        size_t indexEntry = 1 + VarInt::encodedSize(recordHeader + blockSize)
+                          + VarInt::encodedSize(uint64_t(blockSize) * 8) + VarInt::encodedSize(blockSize);
+        return 2 + size + blocks * (recordHeader + indexEntry) + 1
+             + VarInt::encodedSize(blocks) + BlockCodec::kTrailerSize;
+    }
+
+    // 压缩到 out（原有内容被替换）
+    static bool compress(const uint8_t* data, size_t size, std::vector<uint8_t>& out, Context& context,
+                         const CompressOptions& options = CompressOptions()) {
+        out.clear();
+        return compressBlocks(data, size, context, options, [&](size_t bytes) {
+            size_t start = out.size();
+            out.resize(start + bytes);
+            return out.data() + start;
+        });
+    }
+
+    // 压缩到调用方的缓冲区，written 返回写入的字节数；各块记录直接编码到 destination 中，
+    // 容量按 compressBound 预留时一定够用
+    static bool compress(const uint8_t* data, size_t size, uint8_t* destination, size_t capacity,
+                         size_t& written, Context& context, const CompressOptions& options = CompressOptions()) {
+        written = 0;
+        return compressBlocks(data, size, context, options, [&](size_t bytes) -> uint8_t* {
+            if (bytes > capacity - written) {
+                std::cerr << "错误：输出缓冲区不足" << std::endl;
+                return nullptr;
+            }
+            uint8_t* target = destination + written;
+            written += bytes;
+            return target;
+        });
+    }
+
+    // 解压后的原始字节数（逐条读取块头，不解码）
+    static bool decompressedSize(const uint8_t* data, size_t size, uint64_t& rawSize) {
+        rawSize = 0;
+        return forEachRecord(data, size, [&](uint8_t, uint32_t blockSize, const uint8_t*, uint32_t, const uint32_t*) {
+            rawSize += blockSize;
+            return true;
+        });
+    }
+
+    // 解压到 out（原有内容被替换）
+    static bool decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& out, Context& context) {
+        out.clear();
+        uint64_t rawSize = 0;
+        if (decompressedSize(data, size, rawSize)) {
+            out.reserve(static_cast<size_t>(rawSize));
+        }
+        return decompressBlocks(data, size, context, [&](size_t bytes) {
+            size_t start = out.size();
+            out.resize(start + bytes);
+            return reinterpret_cast<char*>(out.data() + start);
+        });
+    }
+
+    // 解压到调用方的缓冲区，written 返回写入的字节数；各块直接解码到 destination 中，
+    // 所需容量可由 decompressedSize 得到
+    static bool decompress(const uint8_t* data, size_t size, uint8_t* destination, size_t capacity,
+                           size_t& written, Context& context) {
+        written = 0;
+        return decompressBlocks(data, size, context, [&](size_t bytes) -> char* {
+            if (bytes > capacity - written) {
+                std::cerr << "错误：输出缓冲区不足" << std::endl;
+                return nullptr;
+            }
+            char* target = reinterpret_cast<char*>(destination + written);
+            written += bytes;
+            return target;
+        });
+    }
+
+private:
+    // 与 FileCompressor::compressBlocks 按同样的顺序选择块类型，输出相同
+    // 输出按顺序写到 reserve(n) 返回的 n 字节空间：块记录的大小由块计划精确算出，直接编码到那里；
+    // reserve 返回 nullptr（容量不足）时停止
+    template <typename Reserve>
+    static bool compressBlocks(const uint8_t* data, size_t size, Context& context, const CompressOptions& options,
+                               Reserve reserve) {
+        if (!FileCompressor::validBlockSize(options)) {
+            return false;
+        }
+        uint8_t* header = reserve(2);
+        if (header == nullptr) {
+            return false;
+        }
+        header[0] = 'f';
+        header[1] = FileCompressor::kFormatVersion;
+        uint64_t offset = 2;
+
+        context.index.clear();
+        bool hasPrevious = false;
+        for (size_t position = 0; position < size; position += options.blockSize) {
+            const char* block = reinterpret_cast<const char*>(data + position);
+            size_t blockSize = std::min(options.blockSize, size - position);
+            const CanonicalCode::Lengths* previous = hasPrevious ? &context.previous : nullptr;
+
+            BlockCodec::BlockPlan& plan = context.plan;
+            BlockCodec::analyzeBlock(block, blockSize, plan, options.maxCodeLength, options.streams, options.stats);
+            BlockCodec::chooseType(plan, blockSize, previous);
+            size_t recordSize = BlockCodec::recordSize(plan, blockSize, previous);
+            uint8_t* record = reserve(recordSize);
+            if (record == nullptr) {
+                return false;
+            }
+            {
+                Stats::Timer timer(options.stats, Stats::kEncode);
+                BlockCodec::encodeBlockTo(block, blockSize, plan, previous, record);
+            }
+
+            BlockCodec::IndexEntry entry;
+            entry.type = plan.type;
+            entry.recordSize = recordSize;
+            entry.bitCount = BlockCodec::payloadBits(plan);
+            entry.rawSize = blockSize;
+            context.index.push_back(entry);
+            offset += recordSize;
+            if (BlockCodec::hasOwnTable(plan.type)) {
+                context.previous = plan.lengths;
+                hasPrevious = true;
+            }
+        }
+
+        // 结束标记和块索引
+        context.indexBytes.clear();
+        context.indexBytes.push_back(BlockCodec::kEnd);
+        BlockCodec::appendIndex(context.index, offset + 1, context.indexBytes);
+        uint8_t* tail = reserve(context.indexBytes.size());
+        if (tail == nullptr) {
+            return false;
+        }
+        std::memcpy(tail, context.indexBytes.data(), context.indexBytes.size());
+
+        if (options.stats != nullptr) {
+            options.stats->bytesIn = size;
+            options.stats->bytesOut = offset + context.indexBytes.size();
+        }
+        return true;
+    }
+
+    // 检查魔数和版本，按顺序对每条块记录调用 fn(类型, 原始大小, 载荷, 载荷字节数, 校验和)，直到结束标记
+    // 只接受分块格式（版本2起），版本5之前没有校验和，传入nullptr；fn 返回false时停止
+    template <typename Fn>
+    static bool forEachRecord(const uint8_t* data, size_t size, Fn fn) {
+        if (size < 2 || data[0] != 'f') {
+            std::cerr << "错误：不是单文件压缩格式" << std::endl;
+            return false;
+        }
+        if (data[1] < 2 || data[1] > FileCompressor::kFormatVersion) {
+            std::cerr << "错误：不支持的格式版本" << std::endl;
+            return false;
+        }
+
+        size_t checksumBytes = data[1] >= FileCompressor::kChecksumVersion ? BlockCodec::kChecksumSize : 0;
+        const uint8_t* p = data + 2;
+        const uint8_t* end = data + size;
+        while (true) {
+            if (p >= end) {
+                std::cerr << "错误：压缩数据不完整" << std::endl;
+                return false;
+            }
+            if (*p == BlockCodec::kEnd) {
+                return true;
+            }
+            uint8_t type;
+            uint32_t rawSize, payloadSize;
+            const uint8_t* payload;
+            if (!BlockCodec::parseRecord(p, end - p, type, rawSize, payload, payloadSize) ||
+                payloadSize + checksumBytes > static_cast<size_t>(end - payload)) {
+                std::cerr << "错误：块记录损坏" << std::endl;
+                return false;
+            }
+            p = payload + payloadSize;
+            uint32_t checksum = 0;
+            if (checksumBytes > 0) {
+                VarInt::decodeFixed32(p, end, checksum);  // 同时跳过校验和
+            }
+            if (!fn(type, rawSize, payload, payloadSize, checksumBytes > 0 ? &checksum : nullptr)) {
+                return false;
+            }
+        }
+    }
+
+    // 逐块解码并核对校验和：每块直接解码到 reserve(原始大小) 返回的位置，
+    // reserve 返回 nullptr（容量不足）时停止
+    template <typename Reserve>
+    static bool decompressBlocks(const uint8_t* data, size_t size, Context& context, Reserve reserve) {
+        return forEachRecord(data, size, [&](uint8_t type, uint32_t rawSize, const uint8_t* payload,
+                                             uint32_t payloadSize, const uint32_t* checksum) {
+            char* target = reserve(rawSize);
+            return target != nullptr &&
+                   BlockCodec::decodeBlockTo(type, payload, payloadSize, rawSize, context.table, target) &&
+                   (checksum == nullptr || BlockCodec::verifyChecksum(target, rawSize, *checksum));
+        });
+    }
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// 规范哈夫曼码：只需每个字节值的码长即可唯一确定全部码字
+class CanonicalCode {
+public:
+    static constexpr int kMaxCodeLength = 32;  // 格式允许的最大码长
+
+    using Lengths = std::array<uint8_t, 256>;  // 按字节值索引的码长，0表示不出现
+    using Codes = std::array<uint64_t, 256>;
+
+    // 按码长分配规范码：码长短的在前，同码长按字节值递增
+    static Codes assign(const Lengths& lengths) {
+        std::array<uint32_t, kMaxCodeLength + 2> lengthCount{};
+        for (uint8_t length : lengths) {
+            if (length > 0) lengthCount[length]++;
+        }
+
+        std::array<uint64_t, kMaxCodeLength + 2> nextCode{};
+        uint64_t code = 0;
+        for (int bits = 1; bits <= kMaxCodeLength; bits++) {
+            code = (code + lengthCount[bits - 1]) << 1;
+            nextCode[bits] = code;
+        }
+
+        Codes codes{};
+        for (int symbol = 0; symbol < 256; symbol++) {
+            if (lengths[symbol] > 0) {
+                codes[symbol] = nextCode[lengths[symbol]]++;
+            }
+        }
+        return codes;
+    }
+
+    // 检查码长是否构成合法前缀码（Kraft和不超过1，且不超过最大码长）
+    static bool isValid(const Lengths& lengths) {
+        uint64_t kraft = 0;
+        for (uint8_t length : lengths) {
+            if (length > kMaxCodeLength) return false;
+            if (length > 0) kraft += uint64_t(1) << (kMaxCodeLength - length);
+        }
+        return kraft <= (uint64_t(1) << kMaxCodeLength);
+    }
+
+    // 把超过 maxLength 的码长压到 maxLength 以内（调整各码长的计数，Kraft和保持不变）
+    // 原来码长越短的字节值分到的新码长越短
+    static void limit(Lengths& lengths, int maxLength) {
+        int longest = *std::max_element(lengths.begin(), lengths.end());
+        if (longest <= maxLength) return;
+
+        std::vector<uint32_t> lengthCount(longest + 1, 0);
+        for (uint8_t length : lengths) {
+            if (length > 0) lengthCount[length]++;
+        }
+
+        // 每次从最长一层取出一对兄弟叶子：一个上移一层，另一个挂到较浅的叶子下
+        for (int bits = longest; bits > maxLength; bits--) {
+            while (lengthCount[bits] > 0) {
+                int j = bits - 2;
+                while (lengthCount[j] == 0) j--;
+                lengthCount[bits] -= 2;
+                lengthCount[bits - 1] += 1;
+                lengthCount[j + 1] += 2;
+                lengthCount[j] -= 1;
+            }
+        }
+
+        // 按原码长（相同时按字节值）排序后依次分配新码长
+        std::vector<int> symbols;
+        for (int symbol = 0; symbol < 256; symbol++) {
+            if (lengths[symbol] > 0) symbols.push_back(symbol);
+        }
+        std::stable_sort(symbols.begin(), symbols.end(), [&](int a, int b) {
+            return lengths[a] < lengths[b];
+        });
+
+        size_t next = 0;
+        for (int bits = 1; bits <= maxLength; bits++) {
+            for (uint32_t k = 0; k < lengthCount[bits]; k++) {
+                lengths[symbols[next++]] = static_cast<uint8_t>(bits);
+            }
+        }
+    }
+
+    // 用 package-merge 算法求码长不超过 maxLength 的最优前缀码（加权码长最小）
+    // counts 为各字节值的出现次数；maxLength 不足以容纳全部符号时自动放宽到刚好够用
+    static Lengths packageMerge(const std::array<uint64_t, 256>& counts, int maxLength) {
+        Lengths lengths{};
+        std::vector<int> symbols;
+        for (int symbol = 0; symbol < 256; symbol++) {
+            if (counts[symbol] > 0) symbols.push_back(symbol);
+        }
+        if (symbols.empty()) return lengths;
+        if (symbols.size() == 1) {
+            lengths[symbols[0]] = 1;
+            return lengths;
+        }
+
+        size_t n = symbols.size();
+        while ((size_t(1) << maxLength) < n) maxLength++;
+        maxLength = std::min(maxLength, kMaxCodeLength);
+
+        std::stable_sort(symbols.begin(), symbols.end(), [&](int a, int b) {
+            return counts[a] < counts[b];
+        });
+
+        // 每层的候选项：叶子（symbol >= 0）或由下一层相邻两项打成的包（symbol < 0）
+        struct Item {
+            uint64_t weight;
+            int symbol;
+        };
+        std::vector<std::vector<Item>> levels(maxLength);
+
+        // 最深一层只有叶子；往上每层把下一层两两打包，再与叶子按权重归并（同权时叶子在前）
+        for (int level = maxLength - 1; level >= 0; level--) {
+            std::vector<Item> packages;
+            if (level + 1 < maxLength) {
+                const auto& below = levels[level + 1];
+                for (size_t i = 0; i + 1 < below.size(); i += 2) {
+                    packages.push_back({below[i].weight + below[i + 1].weight, -1});
+                }
+            }
+
+            auto& items = levels[level];
+            size_t leaf = 0, package = 0;
+            while (leaf < n || package < packages.size()) {
+                if (package == packages.size() ||
+                    (leaf < n && counts[symbols[leaf]] <= packages[package].weight)) {
+                    items.push_back({counts[symbols[leaf]], symbols[leaf]});
+                    leaf++;
+                } else {
+                    items.push_back(packages[package++]);
+                }
+            }
+        }
+
+        // 顶层取前 2n-2 项；选中的包总是下一层的一个前缀，逐层向下累加叶子出现的次数即为码长
+        size_t selected = 2 * n - 2;
+        for (int level = 0; level < maxLength && selected > 0; level++) {
+            size_t packageCount = 0;
+            for (size_t i = 0; i < selected; i++) {
+                const Item& item = levels[level][i];
+                if (item.symbol >= 0) {
+                    lengths[item.symbol]++;
+                } else {
+                    packageCount++;
+                }
+            }
+            selected = 2 * packageCount;
+        }
+        return lengths;
+    }
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "BlockCodec.hpp"
+#include "ThreadPool.hpp"
+#include "Stats.hpp"
+#include <cstddef>
+
+// 压缩/解压参数（由命令行解析得到）
+struct CompressOptions {
+    size_t threads = ThreadPool::defaultThreadCount();  // 并行线程数（-T）
+    size_t blockSize = BlockCodec::kBlockSize;          // 单文件分块大小
+    int maxCodeLength = 0;                              // 码长上限（--max-code-len），0表示不限制
+    int streams = 4;                                    // 单文件每块的交错子流数（--streams），1为单个流
+    Stats* stats = nullptr;                             // 运行统计（--stats=json），nullptr表示不统计
+    bool checkHash = false;                             // 增量更新时按内容哈希判断文件是否变化（--check-hash）
+};
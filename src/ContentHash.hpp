@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// 文件内容的64位非加密哈希（XXH64 算法），用于在文件夹中找出内容相同的文件
+// 每次处理32字节、4路独立累加，单核可达数GB/s；哈希相同只说明可能重复，
+// 调用方还需比较大小和内容
+class ContentHash {
+private:
+    static constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+    static constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+    static constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+    static uint64_t rotl(uint64_t x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    static uint64_t read64(const uint8_t* p) {
+        uint64_t value;
+        std::memcpy(&value, p, 8);
+        return value;
+    }
+
+    static uint32_t read32(const uint8_t* p) {
+        uint32_t value;
+        std::memcpy(&value, p, 4);
+        return value;
+    }
+
+    static uint64_t round(uint64_t acc, uint64_t input) {
+        acc += input * kPrime2;
+        acc = rotl(acc, 31);
+        return acc * kPrime1;
+    }
+
+    static uint64_t mergeRound(uint64_t acc, uint64_t value) {
+        acc ^= round(0, value);
+        return acc * kPrime1 + kPrime4;
+    }
+
+public:
+    // 按小端读取输入（x86/ARM 均为小端），与 XXH64 参考实现的结果一致
+    static uint64_t of(const void* data, size_t size, uint64_t seed = 0) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        const uint8_t* end = p + size;
+        uint64_t hash;
+
+        if (size >= 32) {
+            uint64_t v1 = seed + kPrime1 + kPrime2;
+            uint64_t v2 = seed + kPrime2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - kPrime1;
+            const uint8_t* limit = end - 32;
+            do {
+                v1 = round(v1, read64(p));
+                v2 = round(v2, read64(p + 8));
+                v3 = round(v3, read64(p + 16));
+                v4 = round(v4, read64(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            hash = mergeRound(hash, v1);
+            hash = mergeRound(hash, v2);
+            hash = mergeRound(hash, v3);
+            hash = mergeRound(hash, v4);
+        } else {
+            hash = seed + kPrime5;
+        }
+        hash += static_cast<uint64_t>(size);
+
+        // 剩余不足32字节的部分
+        while (end - p >= 8) {
+            hash ^= round(0, read64(p));
+            hash = rotl(hash, 27) * kPrime1 + kPrime4;
+            p += 8;
+        }
+        if (end - p >= 4) {
+            hash ^= static_cast<uint64_t>(read32(p)) * kPrime1;
+            hash = rotl(hash, 23) * kPrime2 + kPrime3;
+            p += 4;
+        }
+        while (p < end) {
+            hash ^= (*p++) * kPrime5;
+            hash = rotl(hash, 11) * kPrime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= kPrime2;
+        hash ^= hash >> 29;
+        hash *= kPrime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+};
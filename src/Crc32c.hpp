@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define EASYCOMPRESS_CRC32C_SSE42 1
+#include <nmmintrin.h>
+#endif
+
+// CRC32C（Castagnoli 多项式，与 iSCSI、ext4 相同），用作块记录的校验和
+// x86 上运行时检测 SSE4.2：支持时用 crc32 指令每次处理8字节，单核可达每秒数GB；
+// 否则退回查表实现（8张表，每次处理8字节）
+class Crc32c {
+private:
+    static constexpr uint32_t kPolynomial = 0x82F63B78;  // 反射形式的多项式
+    using Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+    static Tables makeTables() {
+        Tables tables{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (kPolynomial & (0u - (crc & 1)));
+            }
+            tables[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int t = 1; t < 8; t++) {
+                tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+            }
+        }
+        return tables;
+    }
+
+    static uint32_t software(uint32_t crc, const uint8_t* p, size_t size) {
+        static const Tables tables = makeTables();
+        while (size >= 8) {
+            uint32_t low, high;
+            std::memcpy(&low, p, 4);
+            std::memcpy(&high, p + 4, 4);
+            low ^= crc;
+            crc = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF] ^
+                  tables[5][(low >> 16) & 0xFF] ^ tables[4][low >> 24] ^
+                  tables[3][high & 0xFF] ^ tables[2][(high >> 8) & 0xFF] ^
+                  tables[1][(high >> 16) & 0xFF] ^ tables[0][high >> 24];
+            p += 8;
+            size -= 8;
+        }
+        while (size-- > 0) {
+            crc = (crc >> 8) ^ tables[0][(crc ^ *p++) & 0xFF];
+        }
+        return crc;
+    }
+
+#ifdef EASYCOMPRESS_CRC32C_SSE42
+    __attribute__((target("sse4.2")))
+    static uint32_t hardware(uint32_t crc, const uint8_t* p, size_t size) {
+#if defined(__x86_64__)
+        uint64_t crc64 = crc;
+        while (size >= 8) {
+            uint64_t value;
+            std::memcpy(&value, p, 8);
+            crc64 = _mm_crc32_u64(crc64, value);
+            p += 8;
+            size -= 8;
+        }
+        crc = static_cast<uint32_t>(crc64);
+#endif
+        while (size >= 4) {
+            uint32_t value;
+            std::memcpy(&value, p, 4);
+            crc = _mm_crc32_u32(crc, value);
+            p += 4;
+            size -= 4;
+        }
+        while (size-- > 0) {
+            crc = _mm_crc32_u8(crc, *p++);
+        }
+        return crc;
+    }
+
+    static bool hasHardware() {
+        static const bool supported = __builtin_cpu_supports("sse4.2");
+        return supported;
+    }
+#endif
+
+public:
+    // data 的 CRC32C；crc 传入前一段的结果时接着累加
+    static uint32_t of(const void* data, size_t size, uint32_t crc = 0) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        crc = ~crc;
+#ifdef EASYCOMPRESS_CRC32C_SSE42
+        if (hasHardware()) {
+            return ~hardware(crc, p, size);
+        }
+#endif
+        return ~software(crc, p, size);
+    }
+
+    // 查表实现，供基准测试与硬件实现对比
+    static uint32_t ofSoftware(const void* data, size_t size, uint32_t crc = 0) {
+        return ~software(~crc, static_cast<const uint8_t*>(data), size);
+    }
+};
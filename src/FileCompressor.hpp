@@ -3,164 +3,648 @@
 #include "HuffmanTree.hpp"
 #include "TreeSerializer.hpp"
 #include "BitStream.hpp"
+#include "BlockCodec.hpp"
+#include "CompressOptions.hpp"
+#include "ThreadPool.hpp"
+#include "FileIO.hpp"
+#include "VarInt.hpp"
+#include "SpscQueue.hpp"
 #include <fstream>
-#include <bitset>
 #include <iostream>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <algorithm>
 
 class FileCompressor {
 private:
-    // 从文件读取内容并统计字符频率
-    static std::vector<std::pair<char, int>> getFrequenciesFromFile(const std::string& filename) {
-        std::ifstream file(filename, std::ios::binary);
-        if (!file.is_open()) {
-            std::cerr << "错误：无法打开文件 " << filename << std::endl;
-            return {};
+    // 解压流水线中的一个块，在读取、解码、写出三个阶段之间轮转
+    struct DecodedBlock {
+        enum Status { kData, kFinished, kBroken };
+        Status status = kData;
+        uint8_t type = 0;
+        uint32_t rawSize = 0;
+        uint32_t checksum = 0;
+        std::vector<uint8_t> payload;
+        std::string decoded;
+    };
+
+    static constexpr size_t kPipelineBlocks = 4;  // 同时在流水线中的块数
+
+    // 逐块解码直到结束标记：读取线程预读后面的块记录，调用线程解码并核对校验和，写出线程写出前面的块
+    // 内存只有 kPipelineBlocks 个块；checksummed 为块记录末尾是否有校验和（版本5起）
+    static bool decompressBlocks(std::istream& in, std::ostream& out, Stats* stats, bool checksummed) {
+        std::vector<std::unique_ptr<DecodedBlock>> blocks;
+        SpscQueue<DecodedBlock*> empty(kPipelineBlocks);        // 写出线程 -> 读取线程
+        SpscQueue<DecodedBlock*> filled(kPipelineBlocks);       // 读取线程 -> 解码
+        SpscQueue<DecodedBlock*> decoded(kPipelineBlocks + 1);  // 解码 -> 写出线程，最后多一个结束标志
+        for (size_t i = 0; i < kPipelineBlocks; i++) {
+            blocks.push_back(std::make_unique<DecodedBlock>());
+            empty.push(blocks.back().get());
         }
+        std::atomic<bool> failed{false};  // 解码出错后读取线程不再继续读
+
+        // 读取：遇到结束标记或数据不完整时送出一个结束状态的块后退出
+        std::thread reader([&] {
+            while (true) {
+                DecodedBlock* block = empty.pop();
+                Stats::Timer timer(stats, Stats::kRead);
+                int type = in.get();
+                if (failed.load(std::memory_order_relaxed) || type == BlockCodec::kEnd) {
+                    block->status = DecodedBlock::kFinished;
+                } else if (type == std::char_traits<char>::eof()) {
+                    block->status = DecodedBlock::kBroken;
+                } else {
+                    block->type = static_cast<uint8_t>(type);
+                    uint64_t rawSize = VarInt::decode(in);
+                    uint64_t payloadSize = VarInt::decode(in);
+                    block->rawSize = static_cast<uint32_t>(rawSize);
+                    uint8_t checksum[BlockCodec::kChecksumSize];
+                    const uint8_t* p = checksum;
+                    if (!in || !BlockCodec::checkSizes(rawSize, payloadSize) ||
+                        !readPackedBits(in, payloadSize * 8, block->payload) ||
+                        (checksummed && (!in.read(reinterpret_cast<char*>(checksum), sizeof(checksum)) ||
+                                         !VarInt::decodeFixed32(p, checksum + sizeof(checksum), block->checksum)))) {
+                        block->status = DecodedBlock::kBroken;
+                    } else {
+                        block->status = DecodedBlock::kData;
+                        if (stats != nullptr) {
+                            stats->bytesIn += 1 + VarInt::encodedSize(block->rawSize) +
+                                              VarInt::encodedSize(payloadSize) + payloadSize +
+                                              (checksummed ? BlockCodec::kChecksumSize : 0);
+                        }
+                    }
+                }
+                timer.stop();
+                filled.push(block);
+                if (block->status != DecodedBlock::kData) {
+                    return;
+                }
+            }
+        });
+
+        // 写出：nullptr 表示没有更多块；解码失败的块不写出，只归还
+        std::thread writer([&] {
+            while (DecodedBlock* block = decoded.pop()) {
+                if (block->status == DecodedBlock::kData) {
+                    Stats::Timer timer(stats, Stats::kWrite);
+                    out.write(block->decoded.data(), block->decoded.size());
+                    if (stats != nullptr) {
+                        stats->bytesOut += block->decoded.size();
+                    }
+                }
+                empty.push(block);
+            }
+        });
+
+        HuffmanDecoder table;
+        bool ok = true;
+        while (true) {
+            DecodedBlock* block = filled.pop();
+            if (block->status == DecodedBlock::kBroken) {
+                if (ok) {
+                    std::cerr << "错误：压缩数据不完整" << std::endl;
+                }
+                ok = false;
+            }
+            if (block->status != DecodedBlock::kData) {
+                break;
+            }
 
-        std::unordered_map<char, int> freqMap;
-        char ch;
-        while (file.get(ch)) {
-            freqMap[ch]++;
+            // 出错之后继续取完读取线程已送出的块，直到它停下
+            if (ok) {
+                Stats::Timer timer(stats, Stats::kDecode);
+                if (!BlockCodec::decodeBlock(block->type, block->payload.data(), block->payload.size(),
+                                             block->rawSize, table, block->decoded) ||
+                    (checksummed && !BlockCodec::verifyChecksum(block->decoded, block->checksum))) {
+                    ok = false;
+                    failed = true;
+                }
+            }
+            if (!ok) {
+                block->status = DecodedBlock::kBroken;
+            }
+            decoded.push(block);
         }
-        file.close();
+        decoded.push(nullptr);
+        reader.join();
+        writer.join();
+        return ok;
+    }
 
-        std::vector<std::pair<char, int>> charFreqs;
-        for (const auto& pair : freqMap) {
-            charFreqs.push_back(pair);
+    // 借助块索引并行解码：先并行读出各哈夫曼块的码长表，再并行解码所有块并核对校验和（版本5起），
+    // 每块的输出偏移由索引中的原始大小累加得到，结果直接写入最终位置
+    // outputFile 为空时只解码校验、不写出（-t）；rawBytes 不为空时返回原始数据的总字节数
+    static bool decompressBlocksParallel(const std::string& inputFile, const std::string& outputFile,
+                                         const CompressOptions& options, int version,
+                                         uint64_t* rawBytes = nullptr) {
+        RandomAccessFile in(inputFile);
+        if (!in.isOpen() || in.size() < 2 + 1 + BlockCodec::kTrailerSize) {
+            std::cerr << "错误：无法打开压缩文件" << std::endl;
+            return false;
+        }
+        Stats* stats = options.stats;
+
+        // 1. 读取块索引
+        Stats::Timer indexTimer(stats, Stats::kRead);
+        uint8_t trailer[BlockCodec::kTrailerSize];
+        uint64_t trailerOffset = in.size() - BlockCodec::kTrailerSize;
+        if (!in.readAt(trailerOffset, trailer, sizeof(trailer))) {
+            std::cerr << "错误：读取块索引失败" << std::endl;
+            return false;
+        }
+        uint64_t indexOffset = BlockCodec::readIndexOffset(trailer);
+        if (indexOffset < 3 || indexOffset > trailerOffset) {
+            std::cerr << "错误：块索引偏移无效" << std::endl;
+            return false;
+        }
+        std::vector<uint8_t> indexBytes(trailerOffset - indexOffset);
+        std::vector<BlockCodec::IndexEntry> index;
+        if (!in.readAt(indexOffset, indexBytes.data(), indexBytes.size()) ||
+            !BlockCodec::parseIndex(indexBytes.data(), indexBytes.size(), index)) {
+            std::cerr << "错误：块索引损坏" << std::endl;
+            return false;
         }
 
-        return charFreqs;
-    }
+        // 2. 由索引算出每块的记录偏移、输出偏移和码长表来源
+        size_t count = index.size();
+        std::vector<uint64_t> recordOffsets(count);
+        std::vector<uint64_t> outputOffsets(count);
+        std::vector<size_t> tableSources(count);
+        uint64_t recordOffset = 2;
+        uint64_t outputOffset = 0;
+        size_t lastHuffman = SIZE_MAX;
+        for (size_t i = 0; i < count; i++) {
+            // 逐块检查，防止损坏的大数值在累加时回绕
+            if (index[i].recordSize > indexOffset - recordOffset || index[i].rawSize > UINT32_MAX) {
+                std::cerr << "错误：块索引与数据不一致" << std::endl;
+                return false;
+            }
+            recordOffsets[i] = recordOffset;
+            outputOffsets[i] = outputOffset;
+            recordOffset += index[i].recordSize;
+            outputOffset += index[i].rawSize;
+            if (BlockCodec::hasOwnTable(index[i].type)) {
+                lastHuffman = i;
+            } else if (BlockCodec::usesPreviousTable(index[i].type) && lastHuffman == SIZE_MAX) {
+                std::cerr << "错误：复用块之前没有码长表" << std::endl;
+                return false;
+            }
+            tableSources[i] = lastHuffman;
+        }
+        if (recordOffset + 1 != indexOffset) {
+            std::cerr << "错误：块索引与数据不一致" << std::endl;
+            return false;
+        }
 
-public:
-    // 公开的工具方法（供文件夹压缩使用）
-    static void writeBits(const std::string& bits, std::ofstream& out) {
-        // 先写入原始位数
-        int bitCount = bits.length();
-        out.write(reinterpret_cast<const char*>(&bitCount), sizeof(bitCount));
-
-        // 每8位打包成一个字节
-        for (size_t i = 0; i < bits.length(); i += 8) {
-            std::bitset<8> byte;
-            for (int j = 0; j < 8 && i + j < bits.length(); j++) {
-                if (bits[i + j] == '1') {
-                    byte[7 - j] = 1;
+        indexTimer.stop();
+        if (rawBytes != nullptr) {
+            *rawBytes = outputOffset;
+        }
+
+        std::unique_ptr<OutputFile> out;
+        if (!outputFile.empty()) {
+            out = std::make_unique<OutputFile>(outputFile, outputOffset);
+            if (!out->isOpen()) {
+                std::cerr << "错误：无法创建输出文件" << std::endl;
+                return false;
+            }
+        }
+        bool checksummed = version >= kChecksumVersion;
+        size_t trailerBytes = checksummed ? BlockCodec::kChecksumSize : 0;
+
+        ThreadPool pool(options.threads);
+        std::atomic<bool> ok(true);
+
+        // 3. 并行读出各哈夫曼块的码长表，供复用块使用
+        std::vector<CanonicalCode::Lengths> tables(count);
+        pool.parallelFor(count, [&](size_t i) {
+            if (!BlockCodec::hasOwnTable(index[i].type) || !ok) return;
+            Stats::Timer timer(stats, Stats::kRead);
+            std::vector<uint8_t> head(std::min<uint64_t>(index[i].recordSize, BlockCodec::kMaxHeaderSize + 16));
+            uint8_t type;
+            uint32_t rawSize, payloadSize;
+            const uint8_t* payload;
+            size_t headerBytes;
+            if (!in.readAt(recordOffsets[i], head.data(), head.size()) ||
+                !BlockCodec::parseRecord(head.data(), head.size(), type, rawSize, payload, payloadSize) ||
+                !BlockCodec::readTable(payload, head.data() + head.size() - payload, tables[i], headerBytes)) {
+                ok = false;
+            }
+        });
+
+        // 4. 并行解码所有块并写到最终位置
+        pool.parallelFor(count, [&](size_t i) {
+            if (!ok) return;
+            std::vector<uint8_t> record(index[i].recordSize);
+            uint8_t type;
+            uint32_t rawSize, payloadSize;
+            const uint8_t* payload;
+            {
+                Stats::Timer timer(stats, Stats::kRead);
+                if (!in.readAt(recordOffsets[i], record.data(), record.size()) ||
+                    !BlockCodec::parseRecord(record.data(), record.size(), type, rawSize, payload, payloadSize) ||
+                    type != index[i].type || rawSize != index[i].rawSize ||
+                    payloadSize + trailerBytes > static_cast<size_t>(record.data() + record.size() - payload)) {
+                    std::cerr << "错误：块记录损坏" << std::endl;
+                    ok = false;
+                    return;
+                }
+            }
+            uint32_t checksum = 0;
+            const uint8_t* p = payload + payloadSize;
+            VarInt::decodeFixed32(p, p + trailerBytes, checksum);
+
+            HuffmanDecoder table;
+            std::string decoded;
+            {
+                Stats::Timer timer(stats, Stats::kDecode);
+                if (BlockCodec::usesPreviousTable(type)) {
+                    table.buildFromLengths(tables[tableSources[i]]);
                 }
+                if (!BlockCodec::decodeBlock(type, payload, payloadSize, rawSize, table, decoded) ||
+                    (checksummed && !BlockCodec::verifyChecksum(decoded, checksum))) {
+                    ok = false;
+                    return;
+                }
+            }
+            if (out == nullptr) {
+                return;
             }
-            unsigned char byteValue = static_cast<unsigned char>(byte.to_ulong());
-            out.put(byteValue);
+            Stats::Timer timer(stats, Stats::kWrite);
+            if (!out->writeAt(outputOffsets[i], decoded.data(), decoded.size()) && ok.exchange(false)) {
+                std::cerr << "错误：写出失败" << std::endl;
+            }
+        });
+
+        // 出错时不留下只写了一部分的输出文件
+        if (!ok && out != nullptr) {
+            out.reset();
+            discardOutput(outputFile);
         }
+        return ok;
     }
 
-    // 从文件读取位串
-    static std::string readBits(std::ifstream& in, int bitCount = -1) {
-        // 如果没有指定bitCount，从文件读取
-        if (bitCount < 0) {
-            in.read(reinterpret_cast<char*>(&bitCount), sizeof(bitCount));
-            
-            if (in.fail() || bitCount <= 0) {
-                std::cerr << "错误：无法读取位数或位数无效" << std::endl;
-                return "";
+    // 解压完成后记录输入、输出字节数
+    static void recordSizes(Stats* stats, const std::string& inputFile, const std::string& outputFile) {
+        if (stats == nullptr) return;
+        std::error_code inError, outError;
+        uint64_t inSize = std::filesystem::file_size(inputFile, inError);
+        uint64_t outSize = std::filesystem::file_size(outputFile, outError);
+        stats->bytesIn = inError ? 0 : inSize;
+        stats->bytesOut = outError ? 0 : outSize;
+    }
+
+    // 创建压缩文件并写入魔数标识（单文件模式，规范码长头）和格式版本
+    static bool startOutput(const std::string& outputFile, std::ofstream& outFile) {
+        outFile.open(outputFile, std::ios::binary);
+        if (!outFile.is_open()) {
+            std::cerr << "错误：无法创建输出文件" << std::endl;
+            return false;
+        }
+        outFile.put('f');
+        outFile.put(kFormatVersion);
+        return true;
+    }
+
+    // compressBlocks 的输入来源，在读取线程中调用：next 取出下一块（返回块大小，0表示没有更多数据），
+    // buffer 是这一块在批内的缓冲区，需要拷贝时使用；一批编码完成后在编码线程中调用 release
+    // 整个文件映射在内存中：各块直接引用其中的区间，不做拷贝
+    struct MappedBlocks {
+        MappedFile& input;
+        size_t blockSize;
+        Stats* stats;
+        size_t position = 0;
+
+        size_t next(std::vector<char>&, const char*& block) {
+            Stats::Timer timer(stats, Stats::kRead);
+            size_t size = std::min(blockSize, input.size() - position);
+            block = input.data() + position;
+            position += size;
+
+            // 逐页访问一遍：缺页和磁盘读取发生在读取线程里，与上一批的编码重叠
+            unsigned char touched = 0;
+            for (size_t i = 0; i < size; i += 4096) {
+                touched ^= static_cast<unsigned char>(block[i]);
             }
+            volatile unsigned char sink = touched;
+            (void)sink;
+            return size;
         }
 
-        std::string bits;
-        int bytesToRead = (bitCount + 7) / 8;
+        // 这一批已编码完，让内核回收对应的页，常驻内存不随文件大小增长
+        void release(const char* begin, size_t size) {
+            input.release(static_cast<size_t>(begin - input.data()), size);
+        }
+    };
+
+    // 标准输入等不定长的流：读入批内各块自己的缓冲区，缓冲区随批反复使用
+    struct StreamBlocks {
+        std::istream& in;
+        size_t blockSize;
+        Stats* stats;
+        uint64_t bytesRead = 0;
+
+        size_t next(std::vector<char>& buffer, const char*& block) {
+            Stats::Timer timer(stats, Stats::kRead);
+            buffer.resize(blockSize);
+            in.read(buffer.data(), blockSize);
+            size_t size = static_cast<size_t>(in.gcount());
+            block = buffer.data();
+            bytesRead += size;
+            return size;
+        }
 
-        for (int i = 0; i < bytesToRead; i++) {
-            char byte;
-            if (!in.get(byte)) {
-                std::cerr << "错误：读取字节失败" << std::endl;
-                break;
+        void release(const char*, size_t) {}
+    };
+
+    // 压缩流水线中的一批块，在读取、编码、写出三个阶段之间轮转
+    struct BlockBatch {
+        size_t count = 0;
+        std::vector<const char*> blocks;
+        std::vector<size_t> sizes;
+        std::vector<std::vector<char>> buffers;
+        std::vector<BlockCodec::BlockPlan> plans;
+        std::vector<const CanonicalCode::Lengths*> previousTables;
+        std::vector<std::vector<uint8_t>> records;
+
+        explicit BlockBatch(size_t capacity)
+            : blocks(capacity), sizes(capacity), buffers(capacity), plans(capacity),
+              previousTables(capacity), records(capacity) {}
+    };
+
+    static constexpr size_t kPipelineBatches = 3;  // 同时在流水线中的批数：读取、编码、写出各一批
+
+    // 分批并行压缩，读取、编码、写出三个阶段重叠执行：
+    //   读取线程预读下一批（mmap 时预先触发缺页，流输入时读入缓冲区）；
+    //   调用线程并行统计建表，按顺序决定块类型，再并行编码；
+    //   写出线程按顺序写出上一批并刷新，流式输出不必等到输入结束
+    // 阶段之间用无锁队列传递 BlockBatch，批数固定，内存只有 kPipelineBatches 批块
+    // 块类型的选择只依赖块内容，输出与线程数无关
+    // headerSize 为块之前已写出的字节数，用于计算索引偏移；返回写出的总字节数（含 headerSize）
+    template <typename Source>
+    static uint64_t compressBlocks(Source& source, std::ostream& out, const CompressOptions& options,
+                                   uint64_t headerSize) {
+        ThreadPool pool(options.threads);
+        size_t batchSize = pool.size() * 2;
+        std::vector<std::unique_ptr<BlockBatch>> batches;
+        SpscQueue<BlockBatch*> empty(kPipelineBatches);    // 写出线程 -> 读取线程
+        SpscQueue<BlockBatch*> filled(kPipelineBatches);   // 读取线程 -> 编码
+        SpscQueue<BlockBatch*> encoded(kPipelineBatches + 1);  // 编码 -> 写出线程，最后多一个结束标志
+        for (size_t i = 0; i < kPipelineBatches; i++) {
+            batches.push_back(std::make_unique<BlockBatch>(batchSize));
+            empty.push(batches.back().get());
+        }
+
+        // 读取：取不满一批说明输入已结束
+        std::thread reader([&] {
+            while (true) {
+                BlockBatch* batch = empty.pop();
+                batch->count = 0;
+                while (batch->count < batchSize) {
+                    size_t i = batch->count;
+                    batch->sizes[i] = source.next(batch->buffers[i], batch->blocks[i]);
+                    if (batch->sizes[i] == 0) {
+                        break;
+                    }
+                    batch->count++;
+                }
+                filled.push(batch);
+                if (batch->count < batchSize) {
+                    return;
+                }
             }
-            
-            unsigned char ubyte = static_cast<unsigned char>(byte);
-            std::bitset<8> bitset(ubyte);
-            
-            // 转换为字符串
-            for (int j = 7; j >= 0; j--) {
-                if (bits.length() < static_cast<size_t>(bitCount)) {
-                    bits += (bitset[j] ? '1' : '0');
+        });
+
+        // 写出：nullptr 表示没有更多批
+        std::thread writer([&] {
+            while (BlockBatch* batch = encoded.pop()) {
+                Stats::Timer timer(options.stats, Stats::kWrite);
+                for (size_t i = 0; i < batch->count; i++) {
+                    out.write(reinterpret_cast<const char*>(batch->records[i].data()), batch->records[i].size());
+                }
+                out.flush();
+                timer.stop();
+                empty.push(batch);
+            }
+        });
+
+        std::vector<BlockCodec::IndexEntry> index;
+        uint64_t offset = headerSize;
+
+        CanonicalCode::Lengths carried{};  // 上一批最后一个哈夫曼块的码长表
+        bool hasCarried = false;
+        size_t blockCount = 0;
+        size_t repeatCount = 0;
+        size_t storedCount = 0;
+        size_t staticCount = 0;
+
+        while (true) {
+            // 1. 取出读好的一批块
+            BlockBatch* batch = filled.pop();
+            size_t count = batch->count;
+            bool last = count < batchSize;
+
+            // 2. 并行统计直方图、构建各块自己的码长表
+            pool.parallelFor(count, [&](size_t i) {
+                BlockCodec::analyzeBlock(batch->blocks[i], batch->sizes[i], batch->plans[i], options.maxCodeLength,
+                                         options.streams, options.stats);
+            });
+
+            // 3. 按顺序选择块类型：复用块沿用它之前最近一个哈夫曼块的表
+            const CanonicalCode::Lengths* current = hasCarried ? &carried : nullptr;
+            for (size_t i = 0; i < count; i++) {
+                BlockCodec::chooseType(batch->plans[i], batch->sizes[i], current);
+                batch->previousTables[i] = current;
+                if (BlockCodec::hasOwnTable(batch->plans[i].type)) {
+                    current = &batch->plans[i].lengths;
+                } else if (BlockCodec::usesPreviousTable(batch->plans[i].type)) {
+                    repeatCount++;
+                } else if (batch->plans[i].type == BlockCodec::kStatic) {
+                    staticCount++;
+                } else {
+                    storedCount++;
                 }
             }
-        }
 
-        return bits;
+            // 4. 并行编码
+            pool.parallelFor(count, [&](size_t i) {
+                Stats::Timer timer(options.stats, Stats::kEncode);
+                batch->records[i].clear();
+                BlockCodec::encodeBlock(batch->blocks[i], batch->sizes[i], batch->plans[i],
+                                        batch->previousTables[i], batch->records[i]);
+            });
+
+            // 5. 按顺序记录块索引，交给写出线程
+            for (size_t i = 0; i < count; i++) {
+                BlockCodec::IndexEntry entry;
+                entry.type = batch->plans[i].type;
+                entry.recordSize = batch->records[i].size();
+                entry.bitCount = BlockCodec::payloadBits(batch->plans[i]);
+                entry.rawSize = batch->sizes[i];
+                index.push_back(entry);
+                offset += batch->records[i].size();
+            }
+            if (current != nullptr && current != &carried) {
+                carried = *current;
+                hasCarried = true;
+            }
+            blockCount += count;
+            if (count > 0) {
+                source.release(batch->blocks[0],
+                               static_cast<size_t>(batch->blocks[count - 1] - batch->blocks[0]) + batch->sizes[count - 1]);
+            }
+            encoded.push(batch);
+            if (last) {
+                break;
+            }
+        }
+        encoded.push(nullptr);
+        reader.join();
+        writer.join();
+
+        Stats::Timer writeTimer(options.stats, Stats::kWrite);
+        out.put(BlockCodec::kEnd);
+        offset++;
+
+        // 块索引放在结束标记之后，解压时可据此并行解码
+        std::vector<uint8_t> indexBytes;
+        BlockCodec::appendIndex(index, offset, indexBytes);
+        out.write(reinterpret_cast<const char*>(indexBytes.data()), indexBytes.size());
+        out.flush();
+        writeTimer.stop();
+
+        std::cout << "共 " << blockCount << " 个块（复用表 " << repeatCount
+                  << " 个，静态表 " << staticCount << " 个，原样存储 " << storedCount << " 个），"
+                  << pool.size() << " 个线程" << std::endl;
+        return offset + indexBytes.size();
     }
 
-    // 压缩文件
-    static bool compress(const std::string& inputFile) {
-        // 自动生成输出文件名：原文件名 + .huf
-        std::string outputFile = inputFile + ".huf";
-        std::cout << "正在压缩: " << inputFile << " -> " << outputFile << std::endl;
+public:
+    // 'f'格式版本：1为整文件一张表，2为分块，3在分块之后附带块索引，4增加多流块类型，
+    // 5在每条块记录末尾附带原始数据的 CRC32C，6增加内置静态表块类型
+    static constexpr char kFormatVersion = 6;
+    static constexpr int kChecksumVersion = 5;
 
-        // 1. 读取文件并统计字符频率
-        auto charFreqs = getFrequenciesFromFile(inputFile);
-        if (charFreqs.empty()) {
-            std::cerr << "错误：文件为空或无法读取" << std::endl;
+    // 公开的工具方法（供文件夹压缩使用）
+    // 读取4字节的位数头
+    static bool readBitCount(std::istream& in, int& bitCount) {
+        in.read(reinterpret_cast<char*>(&bitCount), sizeof(bitCount));
+        if (in.fail() || bitCount < 0) {
+            std::cerr << "错误：无法读取位数或位数无效" << std::endl;
             return false;
         }
+        return true;
+    }
 
-        std::cout << "发现 " << charFreqs.size() << " 种不同字符" << std::endl;
-
-        // 2. 构建哈夫曼树
-        HuffmanTree tree;
-        tree.buildFromFrequencies(charFreqs);
+    // 分块大小须在 1 到块大小上限之间，解压端按这个上限检查块记录
+    static bool validBlockSize(const CompressOptions& options) {
+        if (options.blockSize == 0 || options.blockSize > BlockCodec::kMaxBlockSize) {
+            std::cerr << "错误：块大小无效" << std::endl;
+            return false;
+        }
+        return true;
+    }
 
-        // 3. 生成编码表
-        tree.generateCodeTable();
+    // 删除写出失败或解压出错时留下的不完整输出文件
+    static void discardOutput(const std::string& outputFile) {
+        std::error_code ec;
+        std::filesystem::remove(outputFile, ec);
+    }
 
-        // 4. 读取文件内容并编码
-        std::ifstream inFile(inputFile, std::ios::binary);
-        std::string fileContent;
-        char ch;
-        while (inFile.get(ch)) {
-            fileContent += ch;
+    // 关闭输出文件并检查写出是否全部成功（磁盘满、I/O 错误等），失败时删除不完整的文件
+    static bool finishOutput(std::ofstream& outFile, const std::string& outputFile) {
+        outFile.close();
+        if (outFile.fail()) {
+            std::cerr << "错误：写出失败" << std::endl;
+            discardOutput(outputFile);
+            return false;
         }
-        inFile.close();
+        return true;
+    }
 
-        std::string encodedData = tree.encode(fileContent);
+    // 读取打包的编码数据（bitCount位，按字节补齐），不再展开成'0'/'1'字符
+    static bool readPackedBits(std::istream& in, uint64_t bitCount, std::vector<uint8_t>& bytes) {
+        bytes.resize((bitCount + 7) / 8);
+        in.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+        if (static_cast<size_t>(in.gcount()) != bytes.size()) {
+            std::cerr << "错误：读取字节失败" << std::endl;
+            return false;
+        }
+        return true;
+    }
 
-        // 5. 写入压缩文件
-        std::ofstream outFile(outputFile, std::ios::binary);
-        if (!outFile.is_open()) {
-            std::cerr << "错误：无法创建输出文件" << std::endl;
+    // 压缩文件
+    static bool compress(const std::string& inputFile, const CompressOptions& options = CompressOptions()) {
+        // 自动生成输出文件名：原文件名 + .huf
+        std::string outputFile = inputFile + ".huf";
+        std::cout << "正在压缩: " << inputFile << " -> " << outputFile << std::endl;
+        if (!validBlockSize(options)) {
             return false;
         }
 
-        // 写入魔数标识（单文件模式）
-        outFile.put('F');
+        // 分块并行编码，峰值内存只有一批块记录，与文件大小无关
+        // 普通文件直接映射；管道、设备、/proc 等长度未知的输入按流逐批读取，不整个读入内存
+        std::ofstream outFile;
+        uint64_t inputSize = 0;
+        uint64_t outputSize = 0;
+        std::error_code ec;
+        if (std::filesystem::is_regular_file(inputFile, ec)) {
+            MappedFile input(inputFile);
+            if (!input.isOpen()) {
+                std::cerr << "错误：无法打开文件 " << inputFile << std::endl;
+                return false;
+            }
+            if (!startOutput(outputFile, outFile)) {
+                return false;
+            }
+            MappedBlocks blocks{input, options.blockSize, options.stats};
+            outputSize = compressBlocks(blocks, outFile, options, 2);
+            inputSize = input.size();
+        } else {
+            std::ifstream in(inputFile, std::ios::binary);
+            if (!in.is_open()) {
+                std::cerr << "错误：无法打开文件 " << inputFile << std::endl;
+                return false;
+            }
+            if (!startOutput(outputFile, outFile)) {
+                return false;
+            }
+            StreamBlocks blocks{in, options.blockSize, options.stats, 0};
+            outputSize = compressBlocks(blocks, outFile, options, 2);
+            if (in.bad()) {
+                std::cerr << "错误：读取输入失败" << std::endl;
+                outFile.close();
+                discardOutput(outputFile);
+                return false;
+            }
+            inputSize = blocks.bytesRead;
+        }
+        if (!finishOutput(outFile, outputFile)) {
+            return false;
+        }
 
-        // 写入树结构
-        BitWriter treeWriter(outFile);
-        TreeSerializer::serialize(tree.getRoot(), treeWriter);
-        treeWriter.flush();
-        
-        // 写入编码数据
-        writeBits(encodedData, outFile);
-        
-        outFile.close();
+        // 统计信息
+        long origSize = static_cast<long>(inputSize);
+        long compSize = static_cast<long>(outputSize);
 
-        // 6. 统计信息
-        std::ifstream origFile(inputFile, std::ios::binary | std::ios::ate);
-        std::ifstream compFile(outputFile, std::ios::binary | std::ios::ate);
-        
-        long origSize = origFile.tellg();
-        long compSize = compFile.tellg();
-        
-        origFile.close();
-        compFile.close();
+        if (options.stats != nullptr) {
+            options.stats->bytesIn = inputSize;
+            options.stats->bytesOut = compSize;
+        }
 
         std::cout << "压缩完成！" << std::endl;
         std::cout << "原始大小: " << origSize << " 字节" << std::endl;
         std::cout << "压缩后大小: " << compSize << " 字节" << std::endl;
-        std::cout << "压缩率: " << (1.0 - (double)compSize / origSize) * 100 << "%" << std::endl;
+        if (origSize > 0) {
+            std::cout << "压缩率: " << (1.0 - (double)compSize / origSize) * 100 << "%" << std::endl;
+        }
 
         return true;
     }
 
     // 解压文件
-    static bool decompress(const std::string& inputFile) {
+    static bool decompress(const std::string& inputFile, const CompressOptions& options = CompressOptions()) {
         // 检查文件是否以.huf结尾
         if (inputFile.length() < 4 || inputFile.substr(inputFile.length() - 4) != ".huf") {
             std::cerr << "错误：文件格式错误，必须是.huf文件" << std::endl;
@@ -176,44 +660,209 @@ public:
             std::cerr << "错误：无法打开压缩文件" << std::endl;
             return false;
         }
-        // 验证魔数
+        // 验证魔数：'F'为旧的树结构头，'f'为规范码长头
         char magic;
         inFile.get(magic);
-        if (magic != 'F') {
+        HuffmanDecoder decoder;
+        uint64_t bitCount = 0;
+
+        if (magic == 'F') {
+            // 1. 反序列化哈夫曼树并构建解码表
+            BitReader treeReader(inFile);
+            HuffmanNodeArena tree;
+            if (!TreeSerializer::deserialize(treeReader, tree)) {
+                std::cerr << "错误：无法读取哈夫曼树" << std::endl;
+                return false;
+            }
+            decoder.buildFromTree(tree);
+
+            int count = 0;
+            if (!readBitCount(inFile, count)) {
+                return false;
+            }
+            bitCount = count;
+        } else if (magic == 'f') {
+            int version = inFile.get();
+            if (version >= 2 && version <= kFormatVersion) {
+                bool ok;
+                if (version >= 3 && options.threads > 1) {
+                    // 有块索引：多线程并行解码，各块直接写到最终位置
+                    inFile.close();
+                    ok = decompressBlocksParallel(inputFile, outputFile, options, version);
+                } else {
+                    // 逐块读取、解码、写出
+                    std::ofstream outFile(outputFile, std::ios::binary);
+                    if (!outFile.is_open()) {
+                        std::cerr << "错误：无法创建输出文件" << std::endl;
+                        return false;
+                    }
+                    ok = decompressBlocks(inFile, outFile, options.stats, version >= kChecksumVersion);
+                    if (!ok) {
+                        outFile.close();
+                        discardOutput(outputFile);
+                    } else {
+                        ok = finishOutput(outFile, outputFile);
+                    }
+                }
+                if (!ok) {
+                    return false;
+                }
+                recordSizes(options.stats, inputFile, outputFile);
+
+                std::cout << "解压完成！" << std::endl;
+                std::cout << "输出文件: " << outputFile << std::endl;
+                return true;
+            }
+            if (version != 1) {
+                std::cerr << "错误：不支持的格式版本" << std::endl;
+                return false;
+            }
+
+            // 1. 读取码长表，直接构建解码表
+            BitReader headerReader(inFile);
+            CanonicalCode::Lengths lengths;
+            if (!TreeSerializer::deserializeLengths(headerReader, lengths)) {
+                return false;
+            }
+            decoder.buildFromLengths(lengths);
+            bitCount = VarInt::decode(inFile);
+        } else {
             std::cerr << "错误：不是单文件压缩格式" << std::endl;
             return false;
         }
-        // 1. 反序列化哈夫曼树
-        BitReader treeReader(inFile);
-        HuffmanNode* root = TreeSerializer::deserialize(treeReader);
-        
-        if (root == nullptr) {
-            std::cerr << "错误：无法读取哈夫曼树" << std::endl;
-            return false;
-        }
 
         // 2. 读取编码数据
-        std::string encodedData = readBits(inFile);
+        std::vector<uint8_t> encodedData;
+        Stats::Timer readTimer(options.stats, Stats::kRead);
+        if (!readPackedBits(inFile, bitCount, encodedData)) {
+            return false;
+        }
         inFile.close();
+        readTimer.stop();
 
-        // 3. 解码
-        std::string decodedData = HuffmanTree::decodeWithRoot(root, encodedData);
+        // 3. 查表解码
+        std::string decodedData;
+        Stats::Timer decodeTimer(options.stats, Stats::kDecode);
+        if (!decoder.decode(encodedData, bitCount, decodedData)) {
+            return false;
+        }
+        decodeTimer.stop();
 
         // 4. 写入解压文件
+        Stats::Timer writeTimer(options.stats, Stats::kWrite);
         std::ofstream outFile(outputFile, std::ios::binary);
         if (!outFile.is_open()) {
             std::cerr << "错误：无法创建输出文件" << std::endl;
-            delete root;
             return false;
         }
 
         outFile << decodedData;
-        outFile.close();
+        if (!finishOutput(outFile, outputFile)) {
+            return false;
+        }
+        writeTimer.stop();
+        recordSizes(options.stats, inputFile, outputFile);
 
         std::cout << "解压完成！" << std::endl;
         std::cout << "输出文件: " << outputFile << std::endl;
 
-        delete root;
+        return true;
+    }
+
+    // 从流压缩到流（-c -，用于管道）：边读边编码写出，内存只有一批块，输出与压缩文件相同
+    // 进度信息仍写到 std::cout，调用方需要把它改到标准错误
+    static bool compressStream(std::istream& in, std::ostream& out, const CompressOptions& options = CompressOptions()) {
+        if (!validBlockSize(options)) {
+            return false;
+        }
+        out.put('f');
+        out.put(kFormatVersion);
+
+        StreamBlocks blocks{in, options.blockSize, options.stats, 0};
+        uint64_t compSize = compressBlocks(blocks, out, options, 2);
+        if (in.bad()) {
+            std::cerr << "错误：读取输入失败" << std::endl;
+            return false;
+        }
+        if (!out) {
+            std::cerr << "错误：写出失败" << std::endl;
+            return false;
+        }
+
+        if (options.stats != nullptr) {
+            options.stats->bytesIn = blocks.bytesRead;
+            options.stats->bytesOut = compSize;
+        }
+        std::cout << "压缩完成！原始大小: " << blocks.bytesRead << " 字节，压缩后大小: " << compSize << " 字节" << std::endl;
+        return true;
+    }
+
+    // 从流解压到流（-d -）：只接受分块格式，逐块解码写出；结束标记之后的块索引不需要读取
+    static bool decompressStream(std::istream& in, std::ostream& out, const CompressOptions& options = CompressOptions()) {
+        int magic = in.get();
+        int version = in.get();
+        if (magic != 'f' || version < 2 || version > kFormatVersion) {
+            std::cerr << "错误：标准输入只支持分块的单文件压缩格式" << std::endl;
+            return false;
+        }
+        if (options.stats != nullptr) {
+            options.stats->bytesIn = 3;  // 魔数、版本和结束标记
+        }
+        if (!decompressBlocks(in, out, options.stats, version >= kChecksumVersion)) {
+            return false;
+        }
+        out.flush();
+        if (!out) {
+            std::cerr << "错误：写出失败" << std::endl;
+            return false;
+        }
+        std::cout << "解压完成！" << std::endl;
+        return true;
+    }
+
+    // 测试压缩文件（-t）：解码所有块并核对校验和，不写出任何文件
+    // 有块索引时按 options.threads 并行；版本5之前没有校验和，只检查能否完整解码
+    static bool test(const std::string& inputFile, const CompressOptions& options = CompressOptions()) {
+        std::ifstream inFile(inputFile, std::ios::binary);
+        if (!inFile.is_open()) {
+            std::cerr << "错误：无法打开压缩文件" << std::endl;
+            return false;
+        }
+        int magic = inFile.get();
+        int version = inFile.get();
+        if (magic != 'f' || version < 2 || version > kFormatVersion) {
+            std::cerr << "错误：只能测试分块的单文件压缩格式（版本2起）" << std::endl;
+            return false;
+        }
+        std::cout << "正在测试: " << inputFile << std::endl;
+
+        uint64_t rawBytes = 0;
+        bool ok;
+        if (version >= 3) {
+            inFile.close();
+            ok = decompressBlocksParallel(inputFile, "", options, version, &rawBytes);
+        } else {
+            // 没有块索引：顺序解码，输出丢弃（没有缓冲区的流不保存任何写入）
+            std::ostream discard(nullptr);
+            Stats counter;
+            Stats* stats = options.stats != nullptr ? options.stats : &counter;
+            ok = decompressBlocks(inFile, discard, stats, false);
+            rawBytes = stats->bytesOut;
+        }
+        if (!ok) {
+            std::cerr << "测试失败：" << inputFile << " 已损坏" << std::endl;
+            return false;
+        }
+
+        if (options.stats != nullptr) {
+            std::error_code ec;
+            uint64_t inSize = std::filesystem::file_size(inputFile, ec);
+            options.stats->bytesIn = ec ? 0 : inSize;
+            options.stats->bytesOut = rawBytes;
+        }
+        std::cout << "测试通过：" << rawBytes << " 字节"
+                  << (version >= kChecksumVersion ? "，校验和全部一致" : "（旧版本没有校验和，只检查了能否解码）")
+                  << std::endl;
         return true;
     }
 };
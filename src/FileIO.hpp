@@ -0,0 +1,264 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <mutex>
+#include <filesystem>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define EASYCOMPRESS_POSIX_IO 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+// 按偏移量读取的只读文件，可被多个线程同时使用
+// POSIX 下用 pread，其他平台退化为加锁的 seekg + read
+class RandomAccessFile {
+private:
+#ifdef EASYCOMPRESS_POSIX_IO
+    int fd = -1;
+#else
+    std::ifstream in;
+    std::mutex mutex;
+#endif
+    uint64_t fileSize = 0;
+
+public:
+    explicit RandomAccessFile(const std::string& path) {
+        std::error_code ec;
+        fileSize = std::filesystem::file_size(path, ec);
+        if (ec) fileSize = 0;
+#ifdef EASYCOMPRESS_POSIX_IO
+        fd = ::open(path.c_str(), O_RDONLY);
+#else
+        in.open(path, std::ios::binary);
+#endif
+    }
+
+    ~RandomAccessFile() {
+#ifdef EASYCOMPRESS_POSIX_IO
+        if (fd >= 0) ::close(fd);
+#endif
+    }
+
+    bool isOpen() const {
+#ifdef EASYCOMPRESS_POSIX_IO
+        return fd >= 0;
+#else
+        return in.is_open();
+#endif
+    }
+
+    uint64_t size() const {
+        return fileSize;
+    }
+
+    // 从offset处读取size字节，读满返回true
+    bool readAt(uint64_t offset, void* data, size_t size) {
+#ifdef EASYCOMPRESS_POSIX_IO
+        char* p = static_cast<char*>(data);
+        while (size > 0) {
+            ssize_t n = ::pread(fd, p, size, static_cast<off_t>(offset));
+            if (n <= 0) return false;
+            p += n;
+            offset += static_cast<uint64_t>(n);
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+#else
+        std::lock_guard<std::mutex> lock(mutex);
+        in.clear();
+        in.seekg(static_cast<std::streamoff>(offset));
+        in.read(static_cast<char*>(data), size);
+        return static_cast<size_t>(in.gcount()) == size;
+#endif
+    }
+
+    RandomAccessFile(const RandomAccessFile&) = delete;
+    RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+};
+
+// 按偏移量写入的输出文件，可被多个线程同时使用
+// 创建时预先设好最终大小，各线程把结果直接写到最终位置
+class OutputFile {
+private:
+#ifdef EASYCOMPRESS_POSIX_IO
+    int fd = -1;
+#else
+    std::fstream out;
+    std::mutex mutex;
+#endif
+
+public:
+    OutputFile(const std::string& path, uint64_t size) {
+        { std::ofstream create(path, std::ios::binary | std::ios::trunc); }
+        std::error_code ec;
+        std::filesystem::resize_file(path, size, ec);
+        if (ec) return;
+#ifdef EASYCOMPRESS_POSIX_IO
+        fd = ::open(path.c_str(), O_WRONLY);
+#else
+        out.open(path, std::ios::binary | std::ios::in | std::ios::out);
+#endif
+    }
+
+    ~OutputFile() {
+#ifdef EASYCOMPRESS_POSIX_IO
+        if (fd >= 0) ::close(fd);
+#endif
+    }
+
+    bool isOpen() const {
+#ifdef EASYCOMPRESS_POSIX_IO
+        return fd >= 0;
+#else
+        return out.is_open();
+#endif
+    }
+
+    // 把size字节写到offset处，全部写完返回true
+    bool writeAt(uint64_t offset, const void* data, size_t size) {
+#ifdef EASYCOMPRESS_POSIX_IO
+        const char* p = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t n = ::pwrite(fd, p, size, static_cast<off_t>(offset));
+            if (n <= 0) return false;
+            p += n;
+            offset += static_cast<uint64_t>(n);
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+#else
+        std::lock_guard<std::mutex> lock(mutex);
+        out.seekp(static_cast<std::streamoff>(offset));
+        out.write(static_cast<const char*>(data), size);
+        return static_cast<bool>(out);
+#endif
+    }
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+};
+
+// 只读的整文件输入：普通文件直接 mmap，内容以指针 + 长度的形式交给直方图和编码器，不做拷贝
+// 只接受普通文件（映射失败或没有 mmap 的平台退化为读入内存）；管道、设备等长度未知的输入
+// isOpen() 为 false，调用方应按流逐块读取，见 FileCompressor::compress
+class MappedFile {
+private:
+    const char* mapped = nullptr;  // mmap 得到的地址（退化读入时为nullptr）
+    std::vector<char> buffer;      // 退化读入时的内容
+    size_t fileSize = 0;
+    bool opened = false;
+
+    // 把 in 中剩余的内容全部读进 buffer
+    template <typename ReadFn>
+    void readAll(ReadFn readSome) {
+        const size_t chunk = 1 << 16;
+        while (true) {
+            size_t used = buffer.size();
+            buffer.resize(used + chunk);
+            long n = readSome(buffer.data() + used, chunk);
+            if (n <= 0) {
+                buffer.resize(used);
+                opened = (n == 0);
+                break;
+            }
+            buffer.resize(used + static_cast<size_t>(n));
+        }
+        fileSize = buffer.size();
+    }
+
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef EASYCOMPRESS_POSIX_IO
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+            ::close(fd);
+            return;
+        }
+        fileSize = static_cast<size_t>(info.st_size);
+        opened = true;
+        if (fileSize > 0) {
+            void* address = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                mapped = static_cast<const char*>(address);
+                ::madvise(address, fileSize, MADV_SEQUENTIAL);
+            } else {
+                fileSize = 0;
+                opened = false;
+            }
+        }
+        if (!opened) {
+            // 映射失败：退化为普通读取
+            readAll([fd](char* data, size_t size) {
+                ssize_t n;
+                do {
+                    n = ::read(fd, data, size);
+                } while (n < 0 && errno == EINTR);
+                return static_cast<long>(n);
+            });
+        }
+        ::close(fd);
+#else
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(path, ec)) return;
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) return;
+        readAll([&in](char* data, size_t size) {
+            in.read(data, size);
+            return static_cast<long>(in.gcount());
+        });
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef EASYCOMPRESS_POSIX_IO
+        if (mapped != nullptr) {
+            ::munmap(const_cast<char*>(mapped), fileSize);
+        }
+#endif
+    }
+
+    bool isOpen() const {
+        return opened;
+    }
+
+    const char* data() const {
+        return mapped != nullptr ? mapped : buffer.data();
+    }
+
+    size_t size() const {
+        return fileSize;
+    }
+
+    // 提示内核 [offset, offset+size) 已处理完，可以回收对应的页，避免大文件占满常驻内存
+    void release(size_t offset, size_t size) {
+#ifdef EASYCOMPRESS_POSIX_IO
+        if (mapped == nullptr) return;
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t first = offset / page * page;
+        size_t end = std::min(offset + size, fileSize);
+        size_t last = end == fileSize ? fileSize : end / page * page;
+        if (last > first) {
+            ::madvise(const_cast<char*>(mapped) + first, last - first, MADV_DONTNEED);
+        }
+#else
+        (void)offset;
+        (void)size;
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
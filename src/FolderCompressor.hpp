@@ -5,22 +5,56 @@
 #include "BitStream.hpp"
 #include "VarInt.hpp"
 #include "FileCompressor.hpp"
+#include "FileIO.hpp"
+#include "Histogram.hpp"
+#include "ThreadPool.hpp"
+#include "CompressOptions.hpp"
+#include "ContentHash.hpp"
 #include <filesystem>
 #include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <iomanip>
+#include <cmath>
 
 namespace fs = std::filesystem;
 
+// 文件夹压缩
+// 'g'/'s' 版本2起在所有条目之后附带中央目录，可直接定位单个文件：
+//   VarInt 条目数 | 每条：VarInt 记录字节数 | 记录
+//   记录：VarInt 路径长度 | 路径原文 | 8字节码长表偏移 | 8字节编码数据偏移
+//         | VarInt 路径位数 | VarInt 内容位数 | 8字节原始大小
+//         | VarInt 重复来源 | 8字节修改时间 | 8字节内容哈希（后三项版本4起）
+//   末尾8字节（小端）：中央目录的起始偏移
+// 记录带长度前缀，以后在记录末尾追加字段时旧版本可以跳过
+// 版本4起内容相同的文件只存第一份：条目中的内容字段为 内容位数*2，
+// 重复文件为 第一份的条目序号*2+1 且没有内容数据；中央目录的重复来源为 序号+1，0表示不是重复文件
+// 修改时间和内容哈希供增量更新（-u）判断文件是否变化
+// 'k'（分组树，版本4起）把直方图相近的文件分成K组，同组共用一张码长表：
+//   VarInt K | K张码长表 | VarInt 文件数 | 每个条目：VarInt 组号 | VarInt 路径位数 | VarInt 内容字段 | 数据
+//   中央目录与'g'/'s'相同，条目的码长表偏移指向所在组的表
+// 's' 版本5起每个条目以1字节码长表选择开头：0 后面跟着这个文件自己的码长表，1+表号 表示改用
+// 内置静态表（见 StaticTables），没有码长表；条目的码长表偏移指向选择字节
 class FolderCompressor {
 private:
     struct FileEntry {
         std::string relativePath;
         std::string absolutePath;
         uint64_t size;
+        int64_t modified;  // 修改时间（文件时钟的纳秒数，只用于和上次压缩时比较）
     };
     
+    static int64_t modifiedTime(const fs::directory_entry& entry) {
+        std::error_code ec;
+        auto time = entry.last_write_time(ec);
+        if (ec) return 0;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+    
     // 收集文件夹下所有文件
     static std::vector<FileEntry> collectFiles(const fs::path& folderPath) {
         std::vector<FileEntry> files;
@@ -32,6 +66,7 @@ private:
                 file.relativePath = fs::relative(entry.path(), baseFolder).string();
                 file.absolutePath = entry.path().string();
                 file.size = entry.file_size();
+                file.modified = modifiedTime(entry);
                 
                 // 统一路径分隔符为 '/'
                 std::replace(file.relativePath.begin(), file.relativePath.end(), '\\', '/');
@@ -43,251 +78,1709 @@ private:
         return files;
     }
     
-    // 读取文件内容
-    static std::string readFileContent(const std::string& filePath) {
-        std::ifstream file(filePath, std::ios::binary);
-        if (!file.is_open()) {
+    // 检查文件内容是否成功打开；打不开时报错
+    static bool checkOpened(const MappedFile& content, const std::string& filePath) {
+        if (!content.isOpen()) {
             std::cerr << "错误：无法打开文件 " << filePath << std::endl;
-            return "";
+            return false;
+        }
+        return true;
+    }
+    
+    static void writeBytes(const std::vector<uint8_t>& bytes, std::ofstream& out) {
+        out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+    
+    // 读取一个条目的编码路径和内容并解码；fileStats 不为空时记入这个条目的耗时
+    static bool readEntry(std::ifstream& in, const HuffmanDecoder& decoder,
+                          uint64_t pathBits, uint64_t contentBits,
+                          std::string& relativePath, std::string& content,
+                          Stats* stats, Stats::FileStats* fileStats) {
+        double* seconds = fileStats != nullptr ? &fileStats->seconds : nullptr;
+        std::vector<uint8_t> pathData, contentData;
+        {
+            Stats::Timer timer(stats, Stats::kRead, seconds);
+            if (!FileCompressor::readPackedBits(in, pathBits, pathData) ||
+                !FileCompressor::readPackedBits(in, contentBits, contentData)) {
+                return false;
+            }
+        }
+        Stats::Timer timer(stats, Stats::kDecode, seconds);
+        return decoder.decode(pathData, pathBits, relativePath) &&
+               decoder.decode(contentData, contentBits, content);
+    }
+    
+    // 统计时为一个解压出的条目追加明细，不统计时返回nullptr
+    static Stats::FileStats* addFileStats(Stats* stats, uint64_t pathBits, uint64_t contentBits) {
+        if (stats == nullptr) return nullptr;
+        stats->files.emplace_back();
+        stats->files.back().bytesIn = (pathBits + 7) / 8 + (contentBits + 7) / 8;
+        return &stats->files.back();
+    }
+    
+    // 检查格式版本字节（版本2起由中央目录解压，顺序读取只用于没有中央目录的版本1）
+    static bool checkVersion(std::ifstream& in, int& version) {
+        version = in.get();
+        if (version < 1 || version > kFormatVersion) {
+            std::cerr << "错误：不支持的格式版本" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    // 读取一张编码表并构建解码表：旧格式为树结构，新格式为规范码长表
+    static bool readDecoder(std::ifstream& in, bool canonical, HuffmanDecoder& decoder) {
+        BitReader reader(in);
+        if (canonical) {
+            CanonicalCode::Lengths lengths;
+            if (!TreeSerializer::deserializeLengths(reader, lengths)) {
+                return false;
+            }
+            decoder.buildFromLengths(lengths);
+            return true;
+        }
+        
+        // 旧格式的树：节点区放在栈上，每个文件重复使用同一块定长数组
+        HuffmanNodeArena tree;
+        if (!TreeSerializer::deserialize(reader, tree)) {
+            std::cerr << "错误：无法读取哈夫曼树" << std::endl;
+            return false;
+        }
+        decoder.buildFromTree(tree);
+        return true;
+    }
+    
+    // 由压缩包名得到输出目录名
+    static std::string outputFolderFor(const std::string& archivePath) {
+        std::string outputFolder = archivePath;
+        size_t pos = outputFolder.find(".huf");
+        if (pos != std::string::npos) {
+            outputFolder = outputFolder.substr(0, pos);
+        }
+        return outputFolder;
+    }
+    
+    // 解压完成后记录压缩包大小和解压出的总字节数
+    static void recordTotals(Stats* stats, const std::string& archivePath) {
+        if (stats == nullptr) return;
+        std::error_code ec;
+        uint64_t archiveSize = fs::file_size(archivePath, ec);
+        stats->bytesIn = ec ? 0 : archiveSize;
+        stats->bytesOut = 0;
+        for (const auto& file : stats->files) {
+            stats->bytesOut += file.bytesOut;
+        }
+    }
+    
+    // 写入解压出的文件（不输出提示）；createFolders 为 false 时调用方已建好所在目录
+    static void writeFile(const std::string& outputFolder, const std::string& relativePath,
+                          const std::string& content, Stats* stats, Stats::FileStats* fileStats,
+                          bool createFolders = true) {
+        {
+            Stats::Timer timer(stats, Stats::kWrite, fileStats != nullptr ? &fileStats->seconds : nullptr);
+            fs::path targetPath = fs::path(outputFolder) / relativePath;
+            if (createFolders) {
+                fs::create_directories(targetPath.parent_path());
+            }
+            
+            std::ofstream outFile(targetPath, std::ios::binary);
+            outFile << content;
+            outFile.close();
+        }
+        if (fileStats != nullptr) {
+            fileStats->path = relativePath;
+            fileStats->bytesOut = content.size();
+        }
+    }
+    
+    // 重复文件：复制已经写出的第一份（sourcePath），不再解码（不输出提示）；所在目录须已建好
+    static bool copyFile(const std::string& outputFolder, const std::string& sourcePath,
+                         const std::string& relativePath, uint64_t size, Stats* stats,
+                         Stats::FileStats* fileStats) {
+        {
+            Stats::Timer timer(stats, Stats::kWrite, fileStats != nullptr ? &fileStats->seconds : nullptr);
+            std::error_code ec;
+            fs::copy_file(fs::path(outputFolder) / sourcePath, fs::path(outputFolder) / relativePath,
+                          fs::copy_options::overwrite_existing, ec);
+            if (ec) {
+                return false;
+            }
+        }
+        if (fileStats != nullptr) {
+            fileStats->path = relativePath;
+            fileStats->bytesOut = size;
+        }
+        return true;
+    }
+    
+    // 创建目录并写入解压出的文件
+    static void writeEntry(const std::string& outputFolder, const std::string& relativePath,
+                           const std::string& content, Stats* stats = nullptr,
+                           Stats::FileStats* fileStats = nullptr) {
+        writeFile(outputFolder, relativePath, content, stats, fileStats);
+        std::cout << "  解压: " << relativePath << " (" << content.size() << "字节)" << std::endl;
+    }
+    
+    static constexpr int kDirectoryVersion = 2;       // 从这个版本起附带中央目录
+    static constexpr int kDedupVersion = 4;           // 从这个版本起支持重复文件
+    static constexpr int kStaticTableVersion = 5;     // 从这个版本起单独树格式的条目可以改用内置静态表
+    static constexpr uint64_t kUnique = UINT64_MAX;   // 不是重复文件
+    
+    // 中央目录中的一项
+    struct DirectoryEntry {
+        std::string path;
+        uint64_t tableOffset = 0;   // 码长表在压缩包中的偏移（全局树格式中各项相同）
+        uint64_t dataOffset = 0;    // 编码路径数据的偏移，编码内容紧随其后
+        uint64_t pathBits = 0;
+        uint64_t contentBits = 0;
+        uint64_t originalSize = 0;
+        uint64_t duplicateOf = kUnique;  // 重复文件所引用的第一份的条目序号
+        int64_t modified = 0;            // 压缩时文件的修改时间
+        uint64_t hash = 0;               // 内容哈希
+        bool tracked = false;            // 记录了修改时间和哈希（版本4起），可供增量更新复用
+        bool tableSelector = false;      // 码长表位置以1字节选择开头（单独树格式版本5起），读取时设置
+    };
+    
+    static constexpr size_t kTrailerSize = 8;  // 中央目录偏移占用的字节数
+    
+    // 中央目录中重复来源字段的值
+    static uint64_t referenceField(uint64_t duplicateOf) {
+        return duplicateOf == kUnique ? 0 : duplicateOf + 1;
+    }
+    
+    // 条目中内容字段的值
+    static uint64_t contentField(uint64_t contentBits, uint64_t duplicateOf) {
+        return duplicateOf == kUnique ? contentBits * 2 : duplicateOf * 2 + 1;
+    }
+    
+    static size_t directoryRecordSize(size_t pathLength, uint64_t pathBits, uint64_t contentBits,
+                                      uint64_t duplicateOf) {
+        size_t size = VarInt::encodedSize(pathLength) + pathLength + 8 + 8
+                    + VarInt::encodedSize(pathBits) + VarInt::encodedSize(contentBits) + 8
+                    + VarInt::encodedSize(referenceField(duplicateOf)) + 8 + 8;
+        return VarInt::encodedSize(size) + size;
+    }
+    
+    static void appendDirectory(const std::vector<DirectoryEntry>& entries, uint64_t directoryOffset,
+                                std::vector<uint8_t>& out) {
+        VarInt::append(out, entries.size());
+        std::vector<uint8_t> record;
+        for (const auto& entry : entries) {
+            record.clear();
+            VarInt::append(record, entry.path.size());
+            record.insert(record.end(), entry.path.begin(), entry.path.end());
+            VarInt::appendFixed64(record, entry.tableOffset);
+            VarInt::appendFixed64(record, entry.dataOffset);
+            VarInt::append(record, entry.pathBits);
+            VarInt::append(record, entry.contentBits);
+            VarInt::appendFixed64(record, entry.originalSize);
+            VarInt::append(record, referenceField(entry.duplicateOf));
+            VarInt::appendFixed64(record, static_cast<uint64_t>(entry.modified));
+            VarInt::appendFixed64(record, entry.hash);
+            
+            VarInt::append(out, record.size());
+            out.insert(out.end(), record.begin(), record.end());
+        }
+        VarInt::appendFixed64(out, directoryOffset);
+    }
+    
+    static bool parseDirectory(const uint8_t* data, size_t size, std::vector<DirectoryEntry>& entries) {
+        const uint8_t* p = data;
+        const uint8_t* end = data + size;
+        uint64_t count = 0;
+        if (!VarInt::decode(p, end, count)) return false;
+        
+        entries.clear();
+        for (uint64_t i = 0; i < count; i++) {
+            uint64_t recordSize = 0;
+            if (!VarInt::decode(p, end, recordSize) || recordSize > uint64_t(end - p)) return false;
+            const uint8_t* recordEnd = p + recordSize;
+            
+            DirectoryEntry entry;
+            uint64_t pathLength = 0;
+            if (!VarInt::decode(p, recordEnd, pathLength) || pathLength > uint64_t(recordEnd - p)) return false;
+            entry.path.assign(reinterpret_cast<const char*>(p), pathLength);
+            p += pathLength;
+            if (!VarInt::decodeFixed64(p, recordEnd, entry.tableOffset) ||
+                !VarInt::decodeFixed64(p, recordEnd, entry.dataOffset) ||
+                !VarInt::decode(p, recordEnd, entry.pathBits) ||
+                !VarInt::decode(p, recordEnd, entry.contentBits) ||
+                !VarInt::decodeFixed64(p, recordEnd, entry.originalSize)) {
+                return false;
+            }
+            // 版本4起的重复来源，只能引用排在前面的条目
+            uint64_t reference = 0;
+            if (p < recordEnd && (!VarInt::decode(p, recordEnd, reference) || reference > i)) {
+                return false;
+            }
+            if (reference > 0) {
+                entry.duplicateOf = reference - 1;
+            }
+            uint64_t modified = 0;
+            if (p < recordEnd) {
+                if (!VarInt::decodeFixed64(p, recordEnd, modified) ||
+                    !VarInt::decodeFixed64(p, recordEnd, entry.hash)) {
+                    return false;
+                }
+                entry.modified = static_cast<int64_t>(modified);
+                entry.tracked = true;
+            }
+            entries.push_back(entry);
+            p = recordEnd;  // 跳过不认识的新字段
+        }
+        return p == end;
+    }
+    
+    static constexpr size_t kScanGroupSize = 256;             // 每组并行扫描的文件数
+    static constexpr size_t kWriteGroupSize = 256;            // 每组并行编码的文件数上限
+    static constexpr uint64_t kWriteGroupBytes = 64 << 20;    // 每组并行编码的原始字节数上限
+    
+    // 一次扫描得到的单个文件信息
+    struct FileScan {
+        std::vector<uint8_t> symbols;   // 内容中出现过的字节值
+        std::vector<uint64_t> counts;   // 对应的出现次数（稀疏直方图，文件很多时也不占太多内存）
+        uint64_t contentSize = 0;       // 扫描时的内容字节数
+        uint64_t hash = 0;              // 内容的哈希
+        uint64_t duplicateOf = kUnique; // 内容与前面某个文件相同时为那个文件的序号（直方图随之清空）
+        const DirectoryEntry* reused = nullptr;  // 增量更新时沿用的旧条目（不统计直方图）
+    };
+    
+    // 整个文件夹的扫描结果
+    struct FolderScan {
+        std::vector<FileScan> files;
+        Histogram::Counts globalCounts{};  // 所有路径和内容的总直方图
+        uint64_t originalSize = 0;
+        int maxCodeLength = 0;             // 码长上限，0表示不限制
+        Stats* stats = nullptr;            // 运行统计，nullptr表示不统计
+        size_t duplicateCount = 0;         // 重复文件数
+        uint64_t duplicateBytes = 0;       // 重复文件省去的内容字节数
+        RandomAccessFile* previous = nullptr;  // 增量更新时的旧压缩包
+    };
+    
+    // 沿用旧条目的编码数据（重复文件只需重新编码路径，不算在内）
+    static bool copiesPrevious(const FileScan& scan) {
+        return scan.reused != nullptr && scan.duplicateOf == kUnique;
+    }
+    
+    // 统计时返回第 i 个文件的耗时累加位置
+    static double* fileSeconds(Stats* stats, size_t i) {
+        return stats != nullptr ? &stats->files[i].seconds : nullptr;
+    }
+    
+    // 路径和内容合在一起的直方图
+    static Histogram::Counts countsOf(const FileEntry& file, const FileScan& scan) {
+        Histogram::Counts counts{};
+        Histogram::accumulate(file.relativePath, counts);
+        for (size_t i = 0; i < scan.symbols.size(); i++) {
+            counts[scan.symbols[i]] += scan.counts[i];
+        }
+        return counts;
+    }
+    
+    static uint64_t bitsWith(const Histogram::Counts& counts, const CanonicalCode::Lengths& lengths) {
+        uint64_t bits = 0;
+        for (int symbol = 0; symbol < 256; symbol++) {
+            bits += counts[symbol] * lengths[symbol];
+        }
+        return bits;
+    }
+    
+    // 由扫描时的稀疏直方图算出内容的编码位数（重复文件为0）
+    static uint64_t contentBitsWith(const FileScan& scan, const CanonicalCode::Lengths& lengths) {
+        uint64_t bits = 0;
+        for (size_t k = 0; k < scan.symbols.size(); k++) {
+            bits += scan.counts[k] * lengths[scan.symbols[k]];
+        }
+        return bits;
+    }
+    
+    // 一个条目（路径位数、内容字段两个VarInt加编码数据）的字节数
+    static uint64_t entrySize(uint64_t pathBits, uint64_t contentBits, uint64_t duplicateOf) {
+        return VarInt::encodedSize(pathBits) + VarInt::encodedSize(contentField(contentBits, duplicateOf))
+             + (pathBits + 7) / 8 + (contentBits + 7) / 8;
+    }
+    
+    static size_t headerSize(const CanonicalCode::Lengths& lengths) {
+        PackedBitWriter writer;
+        TreeSerializer::serializeLengths(lengths, writer);
+        writer.flush();
+        return writer.getBytes().size();
+    }
+    
+    // 由直方图构建规范编码表
+    static void buildTree(const Histogram::Counts& counts, int maxCodeLength, HuffmanTree& tree) {
+        tree.buildFromCounts(counts, maxCodeLength);
+    }
+    
+    // 单独树方案中一个条目的码长表：自己的表，或编码后整个条目更小的内置静态表（版本5起）
+    // 写出时条目以1字节选择开头：0 后面跟着自己的码长表，1+表号 表示内置静态表
+    // 比较大小需要自己的表，所以直方图和树总是要建，静态表只省下码长表占用的字节
+    // 计算方案大小时为每个文件选好，选中单独树方案后写出时直接沿用，只保留码长，不保留整棵树
+    struct EntryTable {
+        CanonicalCode::Lengths lengths{};  // 自己的码长表
+        int staticId = -1;  // 选用的静态表号，-1表示用自己的表
+        uint64_t size = 0;  // 条目（含码长表和目录项）的字节数
+    };
+    
+    static void chooseEntryTable(const FileEntry& file, const FileScan& scan, int maxCodeLength, EntryTable& table) {
+        HuffmanTree own;
+        buildTree(countsOf(file, scan), maxCodeLength, own);
+        table.lengths = own.getCodeLengths();
+        Histogram::Counts pathCounts = Histogram::count(file.relativePath.data(), file.relativePath.size());
+        auto sizeWith = [&](const CanonicalCode::Lengths& lengths) {
+            uint64_t pathBits = bitsWith(pathCounts, lengths);
+            uint64_t contentBits = contentBitsWith(scan, lengths);
+            return 1 + entrySize(pathBits, contentBits, scan.duplicateOf)
+                 + directoryRecordSize(file.relativePath.size(), pathBits, contentBits, scan.duplicateOf);
+        };
+        table.staticId = -1;
+        table.size = headerSize(table.lengths) + sizeWith(table.lengths);
+        if (maxCodeLength != 0 && maxCodeLength < StaticTables::kMaxLength) {
+            return;  // 静态表的码长超过上限
+        }
+        for (int id = 0; id < StaticTables::kCount; id++) {
+            uint64_t size = sizeWith(StaticTables::kLengths[id]);
+            if (size < table.size) {
+                table.size = size;
+                table.staticId = id;
+            }
+        }
+    }
+    
+    // 追加条目开头的码长表选择和（用自己的表时）码长表
+    static void appendEntryTable(const EntryTable& table, std::vector<uint8_t>& record) {
+        record.push_back(static_cast<uint8_t>(table.staticId + 1));
+        if (table.staticId < 0) {
+            PackedBitWriter headerWriter(std::move(record));
+            TreeSerializer::serializeLengths(table.lengths, headerWriter);
+            headerWriter.flush();
+            record = headerWriter.takeBytes();
+        }
+    }
+    
+    // 两个文件的内容是否逐字节相同
+    static bool sameContent(const FileEntry& a, const FileEntry& b) {
+        MappedFile first(a.absolutePath);
+        MappedFile second(b.absolutePath);
+        return first.isOpen() && second.isOpen() && first.size() == second.size() &&
+               std::memcmp(first.data(), second.data(), first.size()) == 0;
+    }
+    
+    // 在前面已扫描的文件中找内容相同的：哈希和大小相同后再逐字节比较，哈希碰撞不会出错
+    // 找到时记为重复文件：清空它的内容直方图，之后只编码路径
+    static bool findDuplicate(const std::vector<FileEntry>& files, FolderScan& scan, size_t index,
+                              std::unordered_multimap<uint64_t, size_t>& seen) {
+        FileScan& fileScan = scan.files[index];
+        if (fileScan.contentSize == 0) {
+            return false;  // 空文件没有内容可省
+        }
+        
+        auto range = seen.equal_range(fileScan.hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            size_t original = it->second;
+            if (scan.files[original].contentSize != fileScan.contentSize) continue;
+            {
+                Stats::Timer timer(scan.stats, Stats::kHistogram, fileSeconds(scan.stats, index));
+                if (!sameContent(files[original], files[index])) continue;
+            }
+            
+            fileScan.duplicateOf = original;
+            fileScan.symbols.clear();
+            fileScan.counts.clear();
+            scan.duplicateCount++;
+            scan.duplicateBytes += fileScan.contentSize;
+            return true;
+        }
+        seen.emplace(fileScan.hash, index);
+        return false;
+    }
+    
+    // 上次压缩后没有变化的文件沿用旧条目：调用方已确认大小（和修改时间）相同，
+    // checkHash 时再读一遍内容比较哈希
+    static bool reuseEntry(const FileEntry& file, const DirectoryEntry& old, bool checkHash, FileScan& scan) {
+        if (checkHash) {
+            MappedFile content(file.absolutePath);
+            if (!content.isOpen() || content.size() != old.originalSize ||
+                ContentHash::of(content.data(), content.size()) != old.hash) {
+                return false;
+            }
+        }
+        scan.reused = &old;
+        scan.contentSize = old.originalSize;
+        scan.hash = old.hash;
+        return true;
+    }
+    
+    // 读一遍所有文件：记录各文件的直方图和内容哈希；
+    // 内容与前面某个文件相同的记为重复文件，不计入全局直方图
+    // candidates 不为空时是增量更新：对应项不为空的文件先尝试沿用旧条目，沿用的不再读取内容
+    // 有文件打不开时返回 false，不生成压缩包
+    static bool scanFiles(const std::vector<FileEntry>& files, ThreadPool& pool,
+                          const CompressOptions& options, FolderScan& scan,
+                          const std::vector<const DirectoryEntry*>* candidates = nullptr) {
+        std::cout << "正在统计字符频率..." << std::endl;
+        scan = FolderScan();
+        scan.maxCodeLength = options.maxCodeLength;
+        scan.stats = options.stats;
+        scan.files.resize(files.size());
+        std::vector<Histogram::Counts> contentCounts;
+        std::unordered_multimap<uint64_t, size_t> seen;  // 内容哈希 -> 第一个有这个哈希的文件
+        std::atomic<bool> opened(true);
+        
+        // 分组并行扫描，组内各文件互不依赖；每组结束后按顺序合并到全局直方图
+        const size_t groupSize = std::max<size_t>(kScanGroupSize, pool.size());
+        for (size_t first = 0; first < files.size(); first += groupSize) {
+            size_t count = std::min(groupSize, files.size() - first);
+            contentCounts.resize(count);
+            
+            pool.parallelFor(count, [&](size_t k) {
+                const FileEntry& file = files[first + k];
+                FileScan& fileScan = scan.files[first + k];
+                
+                Stats::Timer timer(scan.stats, Stats::kHistogram, fileSeconds(scan.stats, first + k));
+                const DirectoryEntry* old = candidates != nullptr ? (*candidates)[first + k] : nullptr;
+                if (old != nullptr && reuseEntry(file, *old, options.checkHash, fileScan)) {
+                    contentCounts[k].fill(0);
+                    return;
+                }
+                MappedFile content(file.absolutePath);
+                if (!checkOpened(content, file.absolutePath)) {
+                    opened = false;
+                    return;
+                }
+                contentCounts[k] = Histogram::count(content.data(), content.size());
+                for (int symbol = 0; symbol < 256; symbol++) {
+                    if (contentCounts[k][symbol] > 0) {
+                        fileScan.symbols.push_back(static_cast<uint8_t>(symbol));
+                        fileScan.counts.push_back(contentCounts[k][symbol]);
+                    }
+                }
+                fileScan.contentSize = content.size();
+                fileScan.hash = ContentHash::of(content.data(), content.size());
+            });
+            if (!opened) {
+                std::cout << std::endl;
+                return false;
+            }
+            
+            // 按文件顺序查重，重复文件总是引用排在最前面的那一份
+            for (size_t k = 0; k < count; k++) {
+                const FileEntry& file = files[first + k];
+                Histogram::accumulate(file.relativePath, scan.globalCounts);
+                if (!findDuplicate(files, scan, first + k, seen)) {
+                    Histogram::merge(scan.globalCounts, contentCounts[k]);
+                }
+                scan.originalSize += file.relativePath.length() + scan.files[first + k].contentSize;
+            }
+            std::cout << "\r  已处理: " << (first + count) << "/" << files.size() << " 个文件" << std::flush;
+        }
+        std::cout << std::endl;
+        return true;
+    }
+    
+    // 用共用的码长表编码时一个条目（不含码长表）和它的目录项的字节数
+    static uint64_t sharedEntrySize(const FileEntry& file, const FileScan& scan,
+                                    const CanonicalCode::Lengths& lengths) {
+        uint64_t pathBits = 0;
+        for (char c : file.relativePath) {
+            pathBits += lengths[static_cast<uint8_t>(c)];
+        }
+        uint64_t contentBits = contentBitsWith(scan, lengths);
+        return entrySize(pathBits, contentBits, scan.duplicateOf)
+             + directoryRecordSize(file.relativePath.size(), pathBits, contentBits, scan.duplicateOf);
+    }
+    
+    // 全局树方案的压缩包大小
+    static uint64_t globalArchiveSize(const std::vector<FileEntry>& files, const FolderScan& scan,
+                                      const HuffmanTree& globalTree) {
+        const auto& lengths = globalTree.getCodeLengths();
+        uint64_t size = 2 + headerSize(lengths) + 2 * VarInt::encodedSize(files.size())
+                      + kTrailerSize;
+        for (size_t i = 0; i < files.size(); i++) {
+            size += sharedEntrySize(files[i], scan.files[i], lengths);
+        }
+        return size;
+    }
+    
+    // 单独树方案中各文件的码长表：每个文件各建一棵树，可并行；沿用旧条目的文件直接复制，不需要
+    static void chooseEntryTables(const std::vector<FileEntry>& files, const FolderScan& scan, ThreadPool& pool,
+                                  std::vector<EntryTable>& tables) {
+        tables.assign(files.size(), EntryTable());
+        pool.parallelFor(files.size(), [&](size_t i) {
+            if (copiesPrevious(scan.files[i])) return;
+            Stats::Timer timer(scan.stats, Stats::kTreeBuild, fileSeconds(scan.stats, i));
+            chooseEntryTable(files[i], scan.files[i], scan.maxCodeLength, tables[i]);
+        });
+    }
+    
+    // 单独树方案的压缩包大小：各条目的字节数之和加上文件头、文件数和末尾的目录偏移
+    static uint64_t separateArchiveSize(const std::vector<FileEntry>& files, const std::vector<EntryTable>& tables) {
+        uint64_t size = 2 + 2 * VarInt::encodedSize(files.size()) + kTrailerSize;
+        for (const EntryTable& table : tables) {
+            size += table.size;
+        }
+        return size;
+    }
+    
+    static constexpr size_t kMaxGroups = 64;    // 分组树方案的组数上限（小于128，组号只占1字节）
+    static constexpr int kClusterRounds = 4;    // 一分为二时重新分配的最多轮数
+    
+    // 分组树方案：每个文件的组号和各组的码长表
+    struct Clustering {
+        std::vector<uint32_t> groups;
+        std::vector<CanonicalCode::Lengths> tables;
+        uint64_t size = UINT64_MAX;   // 压缩包的精确大小
+    };
+    
+    // 参与分组的一个文件：路径和内容合在一起的稀疏直方图
+    struct SparseCounts {
+        std::vector<uint8_t> symbols;
+        std::vector<uint64_t> counts;
+        double ownBits = 0;   // 按自身分布编码的位数（熵），用来衡量放在某组里多花的位数
+    };
+    
+    using GroupModel = std::array<double, 256>;   // 按组内频率估计的每种字节的码长
+    
+    static SparseCounts sparseCountsOf(const FileEntry& file, const FileScan& scan) {
+        Histogram::Counts counts = countsOf(file, scan);
+        SparseCounts item;
+        uint64_t total = 0;
+        for (int symbol = 0; symbol < 256; symbol++) {
+            total += counts[symbol];
+        }
+        for (int symbol = 0; symbol < 256; symbol++) {
+            if (counts[symbol] == 0) continue;
+            item.symbols.push_back(static_cast<uint8_t>(symbol));
+            item.counts.push_back(counts[symbol]);
+            item.ownBits += counts[symbol] * std::log2(static_cast<double>(total) / counts[symbol]);
+        }
+        return item;
+    }
+    
+    static void addCounts(const SparseCounts& item, Histogram::Counts& counts) {
+        for (size_t k = 0; k < item.symbols.size(); k++) {
+            counts[item.symbols[k]] += item.counts[k];
+        }
+    }
+    
+    // 把一个文件的直方图从 from 移到 to
+    static void moveCounts(const SparseCounts& item, Histogram::Counts& from, Histogram::Counts& to) {
+        for (size_t k = 0; k < item.symbols.size(); k++) {
+            from[item.symbols[k]] -= item.counts[k];
+            to[item.symbols[k]] += item.counts[k];
+        }
+    }
+    
+    // 由直方图估计码长 -log2(p)，频率加0.5平滑：没出现过的字节代价很高但有限，文件仍可能换过来
+    static GroupModel modelOf(const Histogram::Counts& counts) {
+        GroupModel model;
+        double total = 128;
+        for (int symbol = 0; symbol < 256; symbol++) {
+            total += counts[symbol];
+        }
+        for (int symbol = 0; symbol < 256; symbol++) {
+            model[symbol] = std::log2(total / (counts[symbol] + 0.5));
+        }
+        return model;
+    }
+    
+    static double modelBits(const SparseCounts& item, const GroupModel& model) {
+        double bits = 0;
+        for (size_t k = 0; k < item.symbols.size(); k++) {
+            bits += item.counts[k] * model[item.symbols[k]];
+        }
+        return bits;
+    }
+    
+    // 用某组的码长表编码这个文件的位数，表中缺少它用到的字节时为 UINT64_MAX
+    static uint64_t tableBits(const SparseCounts& item, const CanonicalCode::Lengths& lengths) {
+        uint64_t bits = 0;
+        for (size_t k = 0; k < item.symbols.size(); k++) {
+            if (lengths[item.symbols[k]] == 0) return UINT64_MAX;
+            bits += item.counts[k] * lengths[item.symbols[k]];
+        }
+        return bits;
+    }
+    
+    // 分组过程中的一组文件
+    struct Group {
+        std::vector<uint32_t> members;   // 文件序号，递增
+        CanonicalCode::Lengths table{};
+        uint64_t size = 0;               // 码长表加各条目（含组号和目录项）的字节数
+        std::vector<Group> halves;       // 尝试一分为二的结果（两组），不值得分时为空
+        int64_t gain = 0;                // 分开后减少的字节数
+    };
+    
+    // 由成员建出这一组的码长表，算出它在压缩包中占的字节数
+    static void measureGroup(const std::vector<FileEntry>& files, const FolderScan& scan,
+                             const std::vector<SparseCounts>& items, Group& group) {
+        Histogram::Counts counts{};
+        for (uint32_t i : group.members) {
+            addCounts(items[i], counts);
+        }
+        HuffmanTree tree;
+        buildTree(counts, scan.maxCodeLength, tree);
+        group.table = tree.getCodeLengths();
+        group.size = headerSize(group.table);
+        for (uint32_t i : group.members) {
+            group.size += 1 + sharedEntrySize(files[i], scan.files[i], group.table);
+        }
+    }
+    
+    // 尝试把一组一分为二：组内多花位数最多的文件作为另一半的种子，再按估计码长把每个文件
+    // 放到更省的一半，反复几轮；两半各自建表后精确算出减少的字节数
+    static void trySplit(const std::vector<FileEntry>& files, const FolderScan& scan,
+                         const std::vector<SparseCounts>& items, Group& group) {
+        group.halves.clear();
+        group.gain = 0;
+        if (group.members.size() < 2) return;
+        
+        Histogram::Counts sums[2] = {};
+        for (uint32_t i : group.members) {
+            addCounts(items[i], sums[0]);
+        }
+        GroupModel model = modelOf(sums[0]);
+        size_t seed = 0;
+        double worst = 0;
+        for (size_t k = 0; k < group.members.size(); k++) {
+            const SparseCounts& item = items[group.members[k]];
+            double excess = modelBits(item, model) - item.ownBits;
+            if (excess > worst) {
+                worst = excess;
+                seed = k;
+            }
+        }
+        if (worst <= 0) return;
+        
+        std::vector<uint8_t> side(group.members.size(), 0);
+        side[seed] = 1;
+        moveCounts(items[group.members[seed]], sums[0], sums[1]);
+        for (int round = 0; round < kClusterRounds; round++) {
+            GroupModel models[2] = {modelOf(sums[0]), modelOf(sums[1])};
+            bool changed = false;
+            for (size_t k = 0; k < group.members.size(); k++) {
+                if (k == seed) continue;
+                const SparseCounts& item = items[group.members[k]];
+                uint8_t better = modelBits(item, models[1]) < modelBits(item, models[0]);
+                if (better != side[k]) {
+                    moveCounts(item, sums[side[k]], sums[better]);
+                    side[k] = better;
+                    changed = true;
+                }
+            }
+            if (!changed) break;
+        }
+        
+        std::vector<Group> halves(2);
+        for (size_t k = 0; k < group.members.size(); k++) {
+            halves[side[k]].members.push_back(group.members[k]);
+        }
+        if (halves[0].members.empty()) return;
+        measureGroup(files, scan, items, halves[0]);
+        measureGroup(files, scan, items, halves[1]);
+        int64_t gain = static_cast<int64_t>(group.size) - static_cast<int64_t>(halves[0].size + halves[1].size);
+        if (gain > 0) {
+            group.halves = std::move(halves);
+            group.gain = gain;
+        }
+    }
+    
+    // 按直方图把文件分成若干组，每组共用一张码长表：从一组开始，每次把分开后压缩包减小最多的一组
+    // 一分为二，直到再分都不会变小（或到达组数上限），组数就是压缩包（含各组码长表和组号）最小时的组数
+    // 每个文件只参与所在组的尝试，计算顺序固定，结果与线程数无关
+    static Clustering clusterFiles(const std::vector<FileEntry>& files, const FolderScan& scan, ThreadPool& pool) {
+        std::vector<SparseCounts> items(files.size());
+        pool.parallelFor(files.size(), [&](size_t i) {
+            items[i] = sparseCountsOf(files[i], scan.files[i]);
+        });
+        
+        std::vector<Group> groups(1);
+        for (size_t i = 0; i < files.size(); i++) {
+            groups[0].members.push_back(static_cast<uint32_t>(i));
+        }
+        measureGroup(files, scan, items, groups[0]);
+        trySplit(files, scan, items, groups[0]);
+        
+        while (groups.size() < kMaxGroups) {
+            size_t best = 0;
+            for (size_t g = 1; g < groups.size(); g++) {
+                if (groups[g].gain > groups[best].gain) best = g;
+            }
+            if (groups[best].gain <= 0) break;
+            
+            std::vector<Group> halves = std::move(groups[best].halves);
+            groups[best] = std::move(halves[0]);
+            groups.push_back(std::move(halves[1]));
+            Group* parts[2] = {&groups[best], &groups.back()};
+            pool.parallelFor(2, [&](size_t k) {
+                trySplit(files, scan, items, *parts[k]);
+            });
+        }
+        
+        Clustering clustering;
+        clustering.groups.resize(files.size());
+        clustering.size = 2 + VarInt::encodedSize(groups.size()) + 2 * VarInt::encodedSize(files.size()) + kTrailerSize;
+        for (size_t g = 0; g < groups.size(); g++) {
+            for (uint32_t i : groups[g].members) {
+                clustering.groups[i] = static_cast<uint32_t>(g);
+            }
+            clustering.tables.push_back(groups[g].table);
+            clustering.size += groups[g].size;
+        }
+        return clustering;
+    }
+    
+    // 编码一个条目：VarInt 路径位数 | VarInt 内容字段 | 路径数据 | [内容数据]，追加在 record
+    // 已有的内容（单独树格式的码长表）之后；位数由扫描时的直方图算出，文件在两次读取之间被改动时返回false
+    // 重复文件只编码路径，不再读取内容；entry 中的偏移相对于条目开头
+    static bool encodeEntry(const FileEntry& file, const FileScan& scan, const HuffmanTree& tree,
+                            std::vector<uint8_t>& record, DirectoryEntry& entry) {
+        const auto& lengths = tree.getCodeLengths();
+        Histogram::Counts pathCounts = Histogram::count(file.relativePath.data(), file.relativePath.size());
+        uint64_t pathBits = bitsWith(pathCounts, lengths);
+        uint64_t contentBits = contentBitsWith(scan, lengths);
+        VarInt::append(record, pathBits);
+        VarInt::append(record, contentField(contentBits, scan.duplicateOf));
+        
+        entry.path = file.relativePath;
+        entry.tableOffset = 0;
+        entry.dataOffset = record.size();
+        entry.pathBits = pathBits;
+        entry.contentBits = contentBits;
+        entry.originalSize = scan.contentSize;
+        entry.duplicateOf = scan.duplicateOf;
+        entry.modified = file.modified;
+        entry.hash = scan.hash;
+        
+        if (scan.duplicateOf != kUnique) {
+            PackedBitWriter writer(std::move(record));
+            tree.encodeTo(file.relativePath, writer);
+            writer.flush();
+            record = writer.takeBytes();
+            return writer.bitsWritten() == pathBits;
+        }
+        
+        MappedFile content(file.absolutePath);
+        if (content.size() != scan.contentSize) {
+            std::cerr << "错误：压缩过程中文件被修改 " << file.absolutePath << std::endl;
+            return false;
+        }
+        PackedBitWriter writer(std::move(record));
+        tree.encodeTo(file.relativePath, writer);
+        writer.flush();
+        uint64_t writtenPathBits = writer.bitsWritten();
+        tree.encodeTo(content.data(), content.size(), writer);
+        writer.flush();
+        record = writer.takeBytes();
+        
+        if (writtenPathBits != pathBits || writer.bitsWritten() - writtenPathBits != contentBits) {
+            std::cerr << "错误：压缩过程中文件被修改 " << file.absolutePath << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    // 复制旧条目的码长表选择和码长表：版本5之前的条目没有选择字节，补上0
+    static bool copyEntryTable(RandomAccessFile& previous, const DirectoryEntry& old, std::vector<uint8_t>& record) {
+        uint64_t offset = old.tableOffset;
+        if (old.tableSelector) {
+            uint8_t selector = 0;
+            if (!readSelector(previous, offset, selector)) {
+                return false;
+            }
+            if (selector > 0) {
+                record.push_back(selector);
+                return true;
+            }
+            offset++;
+        }
+        CanonicalCode::Lengths lengths;
+        std::vector<uint8_t> bytes;
+        if (!readTableAt(previous, offset, lengths, &bytes)) {
+            return false;
+        }
+        record.push_back(0);
+        record.insert(record.end(), bytes.begin(), bytes.end());
+        return true;
+    }
+    
+    // 复制旧压缩包中的条目：码长表、编码路径和编码内容按字节原样复制，只重写两个VarInt字段
+    // （旧条目可能是版本4之前的格式，内容字段的含义不同）
+    static bool copyEntry(RandomAccessFile& previous, const FileEntry& file, const FileScan& scan,
+                          bool withHeader, std::vector<uint8_t>& record, DirectoryEntry& entry) {
+        const DirectoryEntry& old = *scan.reused;
+        if (withHeader && !copyEntryTable(previous, old, record)) {
+            return false;
+        }
+        VarInt::append(record, old.pathBits);
+        VarInt::append(record, contentField(old.contentBits, kUnique));
+        
+        entry = old;
+        entry.path = file.relativePath;
+        entry.tableOffset = 0;
+        entry.tableSelector = false;
+        entry.dataOffset = record.size();
+        entry.modified = file.modified;
+        
+        uint64_t bytes = (old.pathBits + 7) / 8 + (old.contentBits + 7) / 8;
+        size_t start = record.size();
+        record.resize(start + bytes);
+        if (!previous.readAt(old.dataOffset, record.data() + start, bytes)) {
+            std::cerr << "错误：无法读取旧压缩包中的条目 " << old.path << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    static constexpr uint64_t kOwnTable = UINT64_MAX;        // 每个条目自带码长表
+    static constexpr uint64_t kEntryTable = UINT64_MAX - 1;  // 码长表偏移由 encode 填入目录项
+    
+    // 分组并行编码各条目，再按原顺序写出，最后写出中央目录，输出与线程数无关
+    // 每组的文件数和原始字节数都有上限，控制同时驻留的编码结果
+    // position 为第一个条目的偏移；tableOffset 为共用码长表的偏移，或 kOwnTable / kEntryTable
+    // 编码或写出失败时删除 outputFile，不留下不完整的压缩包
+    template <typename Encode>
+    static bool writeEntries(std::ofstream& out, const std::string& outputFile,
+                             const std::vector<FileEntry>& files, ThreadPool& pool,
+                             uint64_t position, uint64_t tableOffset, Stats* stats, Encode encode) {
+        std::vector<std::vector<uint8_t>> records;
+        std::vector<char> results;
+        std::vector<DirectoryEntry> directory(files.size());
+        
+        size_t first = 0;
+        while (first < files.size()) {
+            size_t last = first;
+            uint64_t groupBytes = 0;
+            while (last < files.size() && last - first < kWriteGroupSize &&
+                   (last == first || groupBytes + files[last].size <= kWriteGroupBytes)) {
+                groupBytes += files[last].size;
+                last++;
+            }
+            
+            size_t count = last - first;
+            records.resize(count);
+            results.assign(count, 0);
+            pool.parallelFor(count, [&](size_t k) {
+                records[k].clear();
+                results[k] = encode(first + k, records[k], directory[first + k]);
+            });
+            
+            for (size_t k = 0; k < count; k++) {
+                const FileEntry& file = files[first + k];
+                std::cout << "  压缩: " << file.relativePath << " (" << file.size << "字节)" << std::endl;
+                if (!results[k]) {
+                    out.close();
+                    FileCompressor::discardOutput(outputFile);
+                    return false;
+                }
+                {
+                    Stats::Timer timer(stats, Stats::kWrite, fileSeconds(stats, first + k));
+                    writeBytes(records[k], out);
+                }
+                if (stats != nullptr) {
+                    stats->files[first + k].bytesOut = records[k].size();
+                }
+                
+                DirectoryEntry& entry = directory[first + k];
+                if (tableOffset != kEntryTable) {
+                    entry.tableOffset = tableOffset == kOwnTable ? position : tableOffset;
+                }
+                entry.dataOffset += position;
+                position += records[k].size();
+            }
+            first = last;
+        }
+        
+        Stats::Timer timer(stats, Stats::kWrite);
+        std::vector<uint8_t> directoryBytes;
+        appendDirectory(directory, position, directoryBytes);
+        writeBytes(directoryBytes, out);
+        return FileCompressor::finishOutput(out, outputFile);
+    }
+    
+    // 写出全局树格式
+    static bool writeGlobal(const std::string& outputFile, const std::vector<FileEntry>& files,
+                            const FolderScan& scan, const HuffmanTree& globalTree, ThreadPool& pool) {
+        std::ofstream out(outputFile, std::ios::binary);
+        if (!out.is_open()) {
+            std::cerr << "错误：无法创建输出文件" << std::endl;
+            return false;
+        }
+        
+        // 写入魔数标识（全局树模式，规范码长头）和格式版本
+        out.put('g');
+        out.put(kFormatVersion);
+        
+        // 写入全局码长表
+        BitWriter headerWriter(out);
+        TreeSerializer::serializeLengths(globalTree.getCodeLengths(), headerWriter);
+        headerWriter.flush();
+        
+        // 写入文件数量
+        VarInt::write(out, files.size());
+        
+        // 编码并写入每个文件
+        uint64_t tableOffset = 2;
+        uint64_t position = static_cast<uint64_t>(out.tellp());
+        return writeEntries(out, outputFile, files, pool, position, tableOffset, scan.stats,
+                            [&](size_t i, std::vector<uint8_t>& record, DirectoryEntry& entry) {
+            if (copiesPrevious(scan.files[i])) {
+                Stats::Timer timer(scan.stats, Stats::kRead, fileSeconds(scan.stats, i));
+                return copyEntry(*scan.previous, files[i], scan.files[i], false, record, entry);
+            }
+            Stats::Timer timer(scan.stats, Stats::kEncode, fileSeconds(scan.stats, i));
+            return encodeEntry(files[i], scan.files[i], globalTree, record, entry);
+        });
+    }
+    
+    // 写出单独树格式：各文件的码长表由 chooseEntryTables 选好，编码数据互不依赖，可并行编码
+    static bool writeSeparate(const std::string& outputFile, const std::vector<FileEntry>& files,
+                              const FolderScan& scan, const std::vector<EntryTable>& tables, ThreadPool& pool) {
+        std::ofstream out(outputFile, std::ios::binary);
+        if (!out.is_open()) {
+            std::cerr << "错误：无法创建输出文件" << std::endl;
+            return false;
+        }
+        
+        // 写入魔数标识（单独树模式，规范码长头）和格式版本
+        out.put('s');
+        out.put(kFormatVersion);
+        
+        // 写入文件数量
+        VarInt::write(out, files.size());
+        
+        // 这个文件单独的码长表（包含路径和内容的所有字符）或选中的内置静态表
+        uint64_t position = static_cast<uint64_t>(out.tellp());
+        return writeEntries(out, outputFile, files, pool, position, kOwnTable, scan.stats,
+                            [&](size_t i, std::vector<uint8_t>& record, DirectoryEntry& entry) {
+            if (copiesPrevious(scan.files[i])) {
+                Stats::Timer timer(scan.stats, Stats::kRead, fileSeconds(scan.stats, i));
+                return copyEntry(*scan.previous, files[i], scan.files[i], true, record, entry);
+            }
+            const EntryTable& table = tables[i];
+            Stats::Timer timer(scan.stats, Stats::kEncode, fileSeconds(scan.stats, i));
+            appendEntryTable(table, record);
+            if (table.staticId >= 0) {
+                return encodeEntry(files[i], scan.files[i], StaticTables::encoder(static_cast<uint8_t>(table.staticId)),
+                                   record, entry);
+            }
+            HuffmanTree tree;
+            tree.buildFromCodeLengths(table.lengths);
+            return encodeEntry(files[i], scan.files[i], tree, record, entry);
+        });
+    }
+    
+    // 写出分组树格式：各组的码长表放在文件数之前，每个条目以组号开头
+    static bool writeClustered(const std::string& outputFile, const std::vector<FileEntry>& files,
+                               const FolderScan& scan, const Clustering& clustering, ThreadPool& pool) {
+        std::ofstream out(outputFile, std::ios::binary);
+        if (!out.is_open()) {
+            std::cerr << "错误：无法创建输出文件" << std::endl;
+            return false;
+        }
+        
+        // 写入魔数标识（分组树模式）和格式版本
+        out.put('k');
+        out.put(kFormatVersion);
+        
+        // 写入各组的码长表
+        VarInt::write(out, clustering.tables.size());
+        std::vector<uint64_t> tableOffsets;
+        std::vector<HuffmanTree> trees(clustering.tables.size());
+        for (size_t g = 0; g < clustering.tables.size(); g++) {
+            tableOffsets.push_back(static_cast<uint64_t>(out.tellp()));
+            BitWriter headerWriter(out);
+            TreeSerializer::serializeLengths(clustering.tables[g], headerWriter);
+            headerWriter.flush();
+            trees[g].buildFromCodeLengths(clustering.tables[g]);
+        }
+        
+        // 写入文件数量
+        VarInt::write(out, files.size());
+        
+        uint64_t position = static_cast<uint64_t>(out.tellp());
+        return writeEntries(out, outputFile, files, pool, position, kEntryTable, scan.stats,
+                            [&](size_t i, std::vector<uint8_t>& record, DirectoryEntry& entry) {
+            uint32_t group = clustering.groups[i];
+            VarInt::append(record, group);
+            bool ok;
+            if (copiesPrevious(scan.files[i])) {
+                Stats::Timer timer(scan.stats, Stats::kRead, fileSeconds(scan.stats, i));
+                ok = copyEntry(*scan.previous, files[i], scan.files[i], false, record, entry);
+            } else {
+                Stats::Timer timer(scan.stats, Stats::kEncode, fileSeconds(scan.stats, i));
+                ok = encodeEntry(files[i], scan.files[i], trees[group], record, entry);
+            }
+            entry.tableOffset = tableOffsets[group];
+            return ok;
+        });
+    }
+    
+    // 读取压缩包末尾的中央目录；magic 返回格式魔数
+    static bool readDirectory(RandomAccessFile& in, char& magic, std::vector<DirectoryEntry>& entries) {
+        uint8_t header[2];
+        if (!in.isOpen() || in.size() < 2 + kTrailerSize || !in.readAt(0, header, sizeof(header))) {
+            std::cerr << "错误：无法打开压缩文件" << std::endl;
+            return false;
+        }
+        magic = static_cast<char>(header[0]);
+        if (magic != 'g' && magic != 's' && magic != 'k' && magic != 'G' && magic != 'S') {
+            std::cerr << "错误：不是文件夹压缩格式" << std::endl;
+            return false;
+        }
+        if (magic == 'G' || magic == 'S' || header[1] < kDirectoryVersion) {
+            std::cerr << "错误：旧版本压缩包没有中央目录，请用 -d 完整解压" << std::endl;
+            return false;
+        }
+        if (header[1] > kFormatVersion) {
+            std::cerr << "错误：不支持的格式版本" << std::endl;
+            return false;
+        }
+        
+        uint8_t trailer[kTrailerSize];
+        uint64_t trailerOffset = in.size() - kTrailerSize;
+        uint64_t directoryOffset = 0;
+        const uint8_t* p = trailer;
+        if (!in.readAt(trailerOffset, trailer, sizeof(trailer)) ||
+            !VarInt::decodeFixed64(p, trailer + kTrailerSize, directoryOffset) ||
+            directoryOffset < 2 || directoryOffset > trailerOffset) {
+            std::cerr << "错误：中央目录偏移无效" << std::endl;
+            return false;
+        }
+        
+        std::vector<uint8_t> directoryBytes(trailerOffset - directoryOffset);
+        if (!in.readAt(directoryOffset, directoryBytes.data(), directoryBytes.size()) ||
+            !parseDirectory(directoryBytes.data(), directoryBytes.size(), entries)) {
+            std::cerr << "错误：中央目录损坏" << std::endl;
+            return false;
+        }
+        if (magic == 's' && header[1] >= kStaticTableVersion) {
+            for (auto& entry : entries) {
+                entry.tableSelector = true;
+            }
+        }
+        return true;
+    }
+    
+    // 读取条目开头的码长表选择（0 为自带码长表，1+表号为内置静态表）
+    static bool readSelector(RandomAccessFile& in, uint64_t offset, uint8_t& selector) {
+        if (!in.readAt(offset, &selector, 1) || selector > StaticTables::kCount) {
+            std::cerr << "错误：码长表选择无效" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    // 读取 tableOffset 处的码长表并构建解码表
+    static bool readDecoderAt(RandomAccessFile& in, uint64_t tableOffset, HuffmanDecoder& decoder) {
+        CanonicalCode::Lengths lengths;
+        if (!readTableAt(in, tableOffset, lengths)) {
+            return false;
+        }
+        decoder.buildFromLengths(lengths);
+        return true;
+    }
+    
+    // 读取 tableOffset 处的码长表；bytes 不为空时同时取回码长表的原始字节
+    static bool readTableAt(RandomAccessFile& in, uint64_t tableOffset, CanonicalCode::Lengths& lengths,
+                            std::vector<uint8_t>* bytes = nullptr) {
+        std::vector<uint8_t> header(std::min<uint64_t>(BlockCodec::kMaxHeaderSize,
+                                                       in.size() - std::min(in.size(), tableOffset)));
+        size_t headerBytes = 0;
+        if (header.empty() || !in.readAt(tableOffset, header.data(), header.size()) ||
+            !BlockCodec::readTable(header.data(), header.size(), lengths, headerBytes)) {
+            std::cerr << "错误：无法读取码长表" << std::endl;
+            return false;
+        }
+        if (bytes != nullptr) {
+            bytes->assign(header.begin(), header.begin() + headerBytes);
+        }
+        return true;
+    }
+    
+    // 全局树和分组树格式的条目共用码长表：按码长表偏移各构建一次解码表，单独树格式各条目自带表，不预先读取
+    static bool loadSharedDecoders(RandomAccessFile& in, char magic, const std::vector<DirectoryEntry>& entries,
+                                   std::unordered_map<uint64_t, HuffmanDecoder>& shared) {
+        if (magic != 'g' && magic != 'k') return true;
+        for (const auto& entry : entries) {
+            if (shared.count(entry.tableOffset) == 0 &&
+                !readDecoderAt(in, entry.tableOffset, shared[entry.tableOffset])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // 条目所用的解码表：共用的和内置静态表直接引用，否则读进 local；读取失败时返回nullptr
+    static const HuffmanDecoder* decoderFor(RandomAccessFile& in, const std::unordered_map<uint64_t, HuffmanDecoder>& shared,
+                                            const DirectoryEntry& entry, HuffmanDecoder& local) {
+        auto found = shared.find(entry.tableOffset);
+        if (found != shared.end()) {
+            return &found->second;
+        }
+        uint64_t tableOffset = entry.tableOffset;
+        if (entry.tableSelector) {
+            uint8_t selector = 0;
+            if (!readSelector(in, tableOffset, selector)) {
+                return nullptr;
+            }
+            if (selector > 0) {
+                return &StaticTables::decoder(selector - 1);
+            }
+            tableOffset++;
+        }
+        return readDecoderAt(in, tableOffset, local) ? &local : nullptr;
+    }
+    
+    // 读取 [offset, offset + bytes) 处的编码数据，超出压缩包时返回false
+    static bool readRange(RandomAccessFile& in, uint64_t offset, uint64_t bytes, std::vector<uint8_t>& data) {
+        if (offset > in.size() || bytes > in.size() - offset) {
+            return false;
+        }
+        data.resize(bytes);
+        return in.readAt(offset, data.data(), data.size());
+    }
+    
+    // 由中央目录解码一个条目，核对路径、原始大小和内容哈希（版本4起）；各条目互不依赖，可并行调用
+    // 重复文件的内容在第一份的条目里：content 为nullptr时（-t，以及解压时直接复制第一份）只核对目录信息和路径，
+    // 内容由第一份检查；否则（-x）从第一份的条目解码出内容。shared 为 loadSharedDecoders 得到的共用解码表
+    static bool decodeEntry(RandomAccessFile& in, const std::vector<DirectoryEntry>& entries, size_t i,
+                            const std::unordered_map<uint64_t, HuffmanDecoder>& shared,
+                            std::string* content, Stats* stats, double* seconds = nullptr) {
+        const DirectoryEntry& entry = entries[i];
+        bool duplicate = entry.duplicateOf != kUnique;
+        const DirectoryEntry& source = duplicate ? entries[entry.duplicateOf] : entry;
+        uint64_t bitLimit = in.size() * 8;
+        if (source.originalSize != entry.originalSize || source.hash != entry.hash ||
+            entry.pathBits > bitLimit || source.pathBits > bitLimit || source.contentBits > bitLimit ||
+            entry.dataOffset > in.size() || source.dataOffset > in.size()) {
+            return false;
+        }
+        bool withContent = !duplicate || content != nullptr;
+        
+        // 路径和（非重复文件的）内容相连，单独树格式自带的码长表又紧挨在前面：整段一次读出
+        uint64_t pathBytes = (entry.pathBits + 7) / 8;
+        uint64_t contentBytes = withContent ? (source.contentBits + 7) / 8 : 0;
+        bool ownTable = shared.count(entry.tableOffset) == 0 && entry.tableOffset < entry.dataOffset &&
+                        entry.dataOffset - entry.tableOffset <= BlockCodec::kMaxHeaderSize;
+        uint64_t spanOffset = ownTable ? entry.tableOffset : entry.dataOffset;
+        uint64_t pathStart = entry.dataOffset - spanOffset;
+        
+        HuffmanDecoder pathTable, contentTable;
+        const HuffmanDecoder* pathDecoder = &pathTable;
+        const HuffmanDecoder* contentDecoder = nullptr;
+        std::vector<uint8_t> span, duplicateData;
+        const uint8_t* contentData = nullptr;
+        {
+            Stats::Timer timer(stats, Stats::kRead, seconds);
+            if (!readRange(in, spanOffset, pathStart + pathBytes + (duplicate ? 0 : contentBytes), span)) {
+                return false;
+            }
+            if (!ownTable) {
+                pathDecoder = decoderFor(in, shared, entry, pathTable);
+                if (pathDecoder == nullptr) {
+                    return false;
+                }
+            } else if (!entry.tableSelector || span[0] == 0) {
+                // 自带的码长表在整段开头（版本5起跟在选择字节之后）
+                size_t tableStart = entry.tableSelector ? 1 : 0;
+                CanonicalCode::Lengths lengths;
+                size_t headerBytes = 0;
+                if (!BlockCodec::readTable(span.data() + tableStart, pathStart - tableStart, lengths, headerBytes)) {
+                    return false;
+                }
+                pathTable.buildFromLengths(lengths);
+            } else if (span[0] <= StaticTables::kCount) {
+                pathDecoder = &StaticTables::decoder(span[0] - 1);
+            } else {
+                std::cerr << "错误：码长表选择无效" << std::endl;
+                return false;
+            }
+            
+            if (withContent && !duplicate) {
+                contentDecoder = pathDecoder;
+                contentData = span.data() + pathStart + pathBytes;
+            } else if (withContent) {
+                contentDecoder = source.tableOffset == entry.tableOffset
+                               ? pathDecoder : decoderFor(in, shared, source, contentTable);
+                if (contentDecoder == nullptr ||
+                    !readRange(in, source.dataOffset + (source.pathBits + 7) / 8, contentBytes, duplicateData)) {
+                    return false;
+                }
+                contentData = duplicateData.data();
+            }
+        }
+        
+        Stats::Timer timer(stats, Stats::kDecode, seconds);
+        std::string path;
+        if (!pathDecoder->decode(span.data() + pathStart, entry.pathBits, path) || path != entry.path) {
+            return false;
+        }
+        if (!withContent) {
+            return true;
+        }
+        std::string decoded;
+        std::string& target = content != nullptr ? *content : decoded;
+        target.clear();
+        target.reserve(std::min(entry.originalSize, source.contentBits));  // 每个字节至少1位，目录损坏时不会多分配
+        if (!contentDecoder->decode(contentData, source.contentBits, target) || target.size() != entry.originalSize) {
+            return false;
+        }
+        return !entry.tracked || ContentHash::of(target.data(), target.size()) == entry.hash;
+    }
+    
+    // 由中央目录解压（版本2起的'g'/'s'/'k'）：各条目按目录中的码长表和数据偏移独立解码并写出，
+    // 分组并行，每个线程同时只持有一个文件的内容；组内的目录先按目录项顺序建好，
+    // 每组结束后按条目顺序输出提示。每组先解码写出内容独立的文件，再处理重复文件：
+    // 第一份总排在前面（同组或更早的组），已经写出并核对过哈希，直接复制它，相同的内容只解码一次
+    static bool decompressIndexed(const std::string& archivePath, const CompressOptions& options) {
+        RandomAccessFile in(archivePath);
+        char magic;
+        std::vector<DirectoryEntry> entries;
+        if (!readDirectory(in, magic, entries)) {
+            return false;
+        }
+        std::cout << "解压 " << entries.size() << " 个文件" << std::endl;
+        std::unordered_map<uint64_t, HuffmanDecoder> shared;
+        if (!loadSharedDecoders(in, magic, entries, shared)) {
+            return false;
+        }
+        
+        Stats* stats = options.stats;
+        if (stats != nullptr) {
+            for (const auto& entry : entries) {
+                addFileStats(stats, entry.pathBits, entry.duplicateOf != kUnique ? 0 : entry.contentBits);
+            }
+        }
+        Stats::FileStats* fileStats = stats != nullptr ? &stats->files[stats->files.size() - entries.size()] : nullptr;
+        
+        std::string outputFolder = outputFolderFor(archivePath);
+        ThreadPool pool(options.threads);
+        const size_t groupSize = std::max<size_t>(kWriteGroupSize, pool.size());
+        std::vector<char> results;
+        for (size_t first = 0; first < entries.size(); first += groupSize) {
+            size_t count = std::min(groupSize, entries.size() - first);
+            for (size_t k = 0; k < count; k++) {
+                fs::create_directories((fs::path(outputFolder) / entries[first + k].path).parent_path());
+            }
+            
+            results.assign(count, 0);
+            pool.parallelFor(count, [&](size_t k) {
+                size_t i = first + k;
+                if (entries[i].duplicateOf != kUnique) return;
+                Stats::FileStats* current = fileStats != nullptr ? fileStats + i : nullptr;
+                std::string content;
+                if (decodeEntry(in, entries, i, shared, &content, stats, current != nullptr ? &current->seconds : nullptr)) {
+                    writeFile(outputFolder, entries[i].path, content, stats, current, false);
+                    results[k] = 1;
+                }
+            });
+            
+            // 重复文件只解码路径核对目录项，内容复制第一份；第一份本身不能是重复文件
+            pool.parallelFor(count, [&](size_t k) {
+                size_t i = first + k;
+                const DirectoryEntry& entry = entries[i];
+                if (entry.duplicateOf == kUnique) return;
+                size_t source = static_cast<size_t>(entry.duplicateOf);
+                if (entries[source].duplicateOf != kUnique || (source >= first && !results[source - first])) {
+                    return;
+                }
+                Stats::FileStats* current = fileStats != nullptr ? fileStats + i : nullptr;
+                if (decodeEntry(in, entries, i, shared, nullptr, stats, current != nullptr ? &current->seconds : nullptr) &&
+                    copyFile(outputFolder, entries[source].path, entry.path, entry.originalSize, stats, current)) {
+                    results[k] = 1;
+                }
+            });
+            
+            for (size_t k = 0; k < count; k++) {
+                const DirectoryEntry& entry = entries[first + k];
+                if (!results[k]) {
+                    std::cerr << "错误：无法解压 " << entry.path << "，数据与中央目录不一致" << std::endl;
+                    return false;
+                }
+                std::cout << "  解压: " << entry.path << " (" << entry.originalSize << "字节)" << std::endl;
+            }
         }
         
-        return std::string((std::istreambuf_iterator<char>(file)),
-                           std::istreambuf_iterator<char>());
+        recordTotals(stats, archivePath);
+        std::cout << "解压完成！输出目录: " << outputFolder << std::endl;
+        return true;
     }
     
-    // 获取字符频率
-    static std::vector<std::pair<char, int>> getFrequencies(const std::string& content) {
-        std::unordered_map<char, int> freqMap;
-        for (char ch : content) {
-            freqMap[ch]++;
+    // 按路径找出大小和修改时间都与上次压缩时相同的文件；checkHash 时不看修改时间，留给内容哈希判断
+    // 旧压缩包中的重复文件没有自己的内容数据，不能沿用
+    static std::vector<const DirectoryEntry*> matchPrevious(const std::vector<FileEntry>& files,
+                                                            const std::vector<DirectoryEntry>& previous,
+                                                            bool checkHash) {
+        std::unordered_map<std::string, const DirectoryEntry*> byPath;
+        for (const auto& entry : previous) {
+            byPath.emplace(entry.path, &entry);
         }
-        
-        std::vector<std::pair<char, int>> charFreqs;
-        for (const auto& pair : freqMap) {
-            charFreqs.push_back(pair);
+        std::vector<const DirectoryEntry*> candidates(files.size(), nullptr);
+        for (size_t i = 0; i < files.size(); i++) {
+            auto it = byPath.find(files[i].relativePath);
+            if (it == byPath.end()) continue;
+            const DirectoryEntry& old = *it->second;
+            if (old.tracked && old.duplicateOf == kUnique && old.originalSize == files[i].size &&
+                (checkHash || old.modified == files[i].modified)) {
+                candidates[i] = &old;
+            }
         }
-        
-        return charFreqs;
+        return candidates;
     }
-
-public:
-    // 方案1：全局哈夫曼树（一棵树编码所有文件）
-    static bool compressWithGlobalTree(const std::string& folderPath) {  
-        std::string outputFile = folderPath + ".huf";
-        std::cout << "正在压缩文件夹: " << folderPath << " -> " << outputFile << std::endl;
-        
-        // 1. 收集所有文件
+    
+    // 收集并扫描文件夹；previous 不为空时是增量更新，未变化的文件沿用其中的旧条目
+    static bool prepare(const std::string& folderPath, const CompressOptions& options, ThreadPool& pool,
+                        std::vector<FileEntry>& files, FolderScan& scan,
+                        const std::vector<DirectoryEntry>* previous = nullptr) {
         std::cout << "正在扫描文件..." << std::flush;
-        auto files = collectFiles(folderPath);
+        {
+            Stats::Timer timer(options.stats, Stats::kScan);
+            files = collectFiles(folderPath);
+        }
         std::cout << "\r";
         if (files.empty()) {
             std::cerr << "错误：文件夹为空" << std::endl;
             return false;
         }
-        
         std::cout << "发现 " << files.size() << " 个文件" << std::endl;
-        
-        // 2. 统计全局字符频率
-        std::cout << "正在统计全局字符频率..." << std::endl;
-        std::unordered_map<char, uint64_t> globalFreq;
-        
-        // 统计路径字符
-        for (const auto& file : files) {
-            for (char ch : file.relativePath) {
-                globalFreq[ch]++;
+        if (options.stats != nullptr) {
+            options.stats->files.resize(files.size());
+            for (size_t i = 0; i < files.size(); i++) {
+                options.stats->files[i].path = files[i].relativePath;
+                options.stats->files[i].bytesIn = files[i].size;
             }
         }
         
-        // 统计文件内容字符
-        size_t processedFiles = 0;
-        for (const auto& file : files) {
-            std::string content = readFileContent(file.absolutePath);
-            for (char ch : content) {
-                globalFreq[ch]++;
+        if (previous != nullptr) {
+            std::vector<const DirectoryEntry*> candidates = matchPrevious(files, *previous, options.checkHash);
+            if (!scanFiles(files, pool, options, scan, &candidates)) {
+                return false;
             }
-            processedFiles++;
-            if (processedFiles % 100 == 0 || processedFiles == files.size()) {
-                std::cout << "\r  已处理: " << processedFiles << "/" << files.size() << " 个文件" << std::flush;
+            size_t reused = std::count_if(scan.files.begin(), scan.files.end(), copiesPrevious);
+            std::cout << reused << " 个文件未变化，沿用旧的编码数据；"
+                      << files.size() - reused << " 个需要重新编码" << std::endl;
+        } else {
+            if (!scanFiles(files, pool, options, scan)) {
+                return false;
             }
+            std::cout << "发现 " << Histogram::distinct(scan.globalCounts) << " 种不同字符" << std::endl;
         }
-        std::cout << std::endl;
-        
-        std::cout << "发现 " << globalFreq.size() << " 种不同字符" << std::endl;
-        
-        // 3. 构建全局哈夫曼树
-        std::vector<std::pair<char, int>> charFreqs;
-        for (const auto& pair : globalFreq) {
-            charFreqs.push_back({pair.first, static_cast<int>(pair.second)});
+        if (scan.duplicateCount > 0) {
+            std::cout << "发现 " << scan.duplicateCount << " 个重复文件，只存一份（省去 "
+                      << scan.duplicateBytes << " 字节）" << std::endl;
         }
-        
+        return true;
+    }
+    
+    // 由扫描结果精确算出全局树、单独树和分组树三种方案的大小，只编码最小的一种
+    static bool writeSmaller(const std::string& outputFile, const std::vector<FileEntry>& files,
+                             const FolderScan& scan, ThreadPool& pool, const CompressOptions& options) {
+        // 建表、分组和各方案的大小计算都计入建表阶段（单独树按文件计时）
+        // 单独树方案各文件的码长表留到写出时沿用，不再重新建树
+        std::vector<EntryTable> tables;
+        chooseEntryTables(files, scan, pool, tables);
+        uint64_t separateSize = separateArchiveSize(files, tables);
+        Stats::Timer treeTimer(options.stats, Stats::kTreeBuild);
         HuffmanTree globalTree;
-        globalTree.buildFromFrequencies(charFreqs);
-        globalTree.generateCodeTable();
+        buildTree(scan.globalCounts, scan.maxCodeLength, globalTree);
+        uint64_t globalSize = globalArchiveSize(files, scan, globalTree);
+        Clustering clustering = clusterFiles(files, scan, pool);
+        treeTimer.stop();
         
-        // 4. 写入压缩文件
-        std::ofstream out(outputFile, std::ios::binary);
-        if (!out.is_open()) {
-            std::cerr << "错误：无法创建输出文件" << std::endl;
+        std::cout << "全局树 " << globalSize << " B，单独树 " << separateSize << " B，分组树 "
+                  << clustering.size << " B（" << clustering.tables.size() << " 组）" << std::endl;
+        bool ok;
+        if (globalSize <= separateSize && globalSize <= clustering.size) {
+            std::cout << "全局树更优" << std::endl;
+            ok = writeGlobal(outputFile, files, scan, globalTree, pool);
+        } else if (separateSize <= clustering.size) {
+            std::cout << "单独树更优" << std::endl;
+            ok = writeSeparate(outputFile, files, scan, tables, pool);
+        } else {
+            std::cout << "分组树更优" << std::endl;
+            ok = writeClustered(outputFile, files, scan, clustering, pool);
+        }
+        if (!ok) {
+            std::cerr << "错误：写入压缩文件失败" << std::endl;
             return false;
         }
         
-        // 写入魔数标识（全局树模式）
-        out.put('G');
-        
-        // 写入全局哈夫曼树
-        BitWriter treeWriter(out);
-        TreeSerializer::serialize(globalTree.getRoot(), treeWriter);
-        treeWriter.flush();
-        
-        // 写入文件数量
-        VarInt::write(out, files.size());
-        
-        // 5. 编码并写入每个文件
-        uint64_t totalOriginalSize = 0;
-        uint64_t totalEncodedBits = 0;
+        printStats(outputFile, scan.originalSize, options.stats);
+        return true;
+    }
+    
+    // 增量更新分组树压缩包：沿用旧压缩包的全部码长表，未变化的文件留在原来的组，
+    // 重新编码的文件放进能编码它且位数最少的组；没有这样的组时置 full 并返回false
+    static bool assignPreviousGroups(RandomAccessFile& previous, const std::vector<FileEntry>& files,
+                                     const FolderScan& scan, Clustering& clustering, bool& full) {
+        uint8_t buffer[10];
+        size_t available = static_cast<size_t>(std::min<uint64_t>(sizeof(buffer), previous.size() - 2));
+        const uint8_t* p = buffer;
+        uint64_t groupCount = 0;
+        if (!previous.readAt(2, buffer, available) || !VarInt::decode(p, buffer + available, groupCount) ||
+            groupCount == 0 || groupCount > kMaxGroups) {
+            std::cerr << "错误：无法读取旧压缩包的组数" << std::endl;
+            return false;
+        }
+        std::vector<uint64_t> tableOffsets;
+        uint64_t offset = 2 + (p - buffer);
+        for (uint64_t g = 0; g < groupCount; g++) {
+            CanonicalCode::Lengths lengths;
+            std::vector<uint8_t> bytes;
+            if (!readTableAt(previous, offset, lengths, &bytes)) {
+                return false;
+            }
+            tableOffsets.push_back(offset);
+            clustering.tables.push_back(lengths);
+            offset += bytes.size();
+        }
         
-        for (const auto& file : files) {
-            std::cout << "  压缩: " << file.relativePath << " (" << file.size << "字节)" << std::endl;
-            
-            // 编码路径
-            std::string encodedPath = globalTree.encode(file.relativePath);
-            
-            // 读取并编码内容
-            std::string content = readFileContent(file.absolutePath);
-            std::string encodedContent = globalTree.encode(content);
-            
-            // 写入元数据
-            VarInt::write(out, encodedPath.length());
-            VarInt::write(out, encodedContent.length());
-            
-            // 写入编码数据
-            FileCompressor::writeBits(encodedPath, out);
-            FileCompressor::writeBits(encodedContent, out);
-            
-            totalOriginalSize += file.relativePath.length() + file.size;
-            totalEncodedBits += encodedPath.length() + encodedContent.length();
+        clustering.groups.assign(files.size(), 0);
+        for (size_t i = 0; i < files.size(); i++) {
+            if (copiesPrevious(scan.files[i])) {
+                auto it = std::find(tableOffsets.begin(), tableOffsets.end(), scan.files[i].reused->tableOffset);
+                if (it == tableOffsets.end()) {
+                    std::cerr << "错误：旧条目的码长表偏移无效 " << files[i].relativePath << std::endl;
+                    return false;
+                }
+                clustering.groups[i] = static_cast<uint32_t>(it - tableOffsets.begin());
+                continue;
+            }
+            SparseCounts item = sparseCountsOf(files[i], scan.files[i]);
+            uint64_t best = UINT64_MAX;
+            for (uint32_t g = 0; g < groupCount; g++) {
+                uint64_t bits = tableBits(item, clustering.tables[g]);
+                if (bits < best) {
+                    best = bits;
+                    clustering.groups[i] = g;
+                }
+            }
+            if (best == UINT64_MAX) {
+                full = true;
+                return false;
+            }
         }
+        return true;
+    }
+    
+    // 增量更新的主体：扫描时沿用 previous 中的未变化条目，写到 outputFile
+    // 需要完整重新压缩时置 full 并返回false
+    static bool updateFrom(const std::string& folderPath, RandomAccessFile& previous, char magic,
+                           const std::vector<DirectoryEntry>& previousEntries, const std::string& outputFile,
+                           const CompressOptions& options, bool& full) {
+        std::vector<FileEntry> files;
+        FolderScan scan;
+        ThreadPool pool(options.threads);
+        if (!prepare(folderPath, options, pool, files, scan, &previousEntries)) {
+            return false;
+        }
+        scan.previous = &previous;
         
-        out.close();
+        // 没有可沿用的条目时扫描结果已经完整，按普通压缩选择方案
+        if (std::none_of(scan.files.begin(), scan.files.end(), copiesPrevious)) {
+            return writeSmaller(outputFile, files, scan, pool, options);
+        }
         
-        // 6. 统计信息
+        bool ok;
+        if (magic == 's') {
+            std::vector<EntryTable> tables;
+            chooseEntryTables(files, scan, pool, tables);
+            ok = writeSeparate(outputFile, files, scan, tables, pool);
+        } else if (magic == 'k') {
+            Clustering clustering;
+            {
+                Stats::Timer timer(options.stats, Stats::kTreeBuild);
+                if (!assignPreviousGroups(previous, files, scan, clustering, full)) {
+                    if (full) {
+                        std::cout << "重新编码的文件中有各组码长表都没有的字符，完整压缩" << std::endl;
+                    }
+                    return false;
+                }
+            }
+            ok = writeClustered(outputFile, files, scan, clustering, pool);
+        } else {
+            // 沿用旧的全局码长表：重新编码的路径和内容中的每种字符都必须有码字
+            HuffmanTree globalTree;
+            {
+                Stats::Timer timer(options.stats, Stats::kTreeBuild);
+                CanonicalCode::Lengths lengths;
+                if (!readTableAt(previous, 2, lengths)) {
+                    return false;
+                }
+                for (size_t i = 0; i < files.size() && !full; i++) {
+                    if (copiesPrevious(scan.files[i])) continue;
+                    Histogram::Counts counts = countsOf(files[i], scan.files[i]);
+                    for (int symbol = 0; symbol < 256; symbol++) {
+                        if (counts[symbol] > 0 && lengths[symbol] == 0) {
+                            full = true;
+                            break;
+                        }
+                    }
+                }
+                if (full) {
+                    std::cout << "重新编码的文件中有旧码长表没有的字符，完整压缩" << std::endl;
+                    return false;
+                }
+                globalTree.buildFromCodeLengths(lengths);
+            }
+            ok = writeGlobal(outputFile, files, scan, globalTree, pool);
+        }
+        if (!ok) {
+            std::cerr << "错误：写入压缩文件失败" << std::endl;
+            return false;
+        }
+        printStats(outputFile, scan.originalSize, options.stats);
+        return true;
+    }
+    
+    static void printStats(const std::string& outputFile, uint64_t originalSize, Stats* stats) {
         uint64_t compressedSize = fs::file_size(outputFile);
+        if (stats != nullptr) {
+            stats->bytesIn = originalSize;
+            stats->bytesOut = compressedSize;
+        }
         std::cout << "\n压缩完成！" << std::endl;
-        std::cout << "原始大小: " << totalOriginalSize << " 字节" << std::endl;
+        std::cout << "原始大小: " << originalSize << " 字节" << std::endl;
         std::cout << "压缩后大小: " << compressedSize << " 字节" << std::endl;
-        std::cout << "压缩率: " << (1.0 - (double)compressedSize / totalOriginalSize) * 100 << "%" << std::endl;
-        
-        return true;
+        if (originalSize > 0) {
+            std::cout << "压缩率: " << (1.0 - (double)compressedSize / originalSize) * 100 << "%" << std::endl;
+        }
     }
-    
-    // 方案2：单独哈夫曼树（每个文件一棵树）
-    static bool compressWithSeparateTrees(const std::string& folderPath) {
+
+public:
+    // 'g'/'s'格式版本：1为条目序列，2在条目之后附带中央目录，
+    // 3起位数、大小和文件数均按64位VarInt写入（值小于2^32时字节与版本2相同，
+    // 版本号用来让只认32位的旧程序拒绝可能含大数值的压缩包），4起内容相同的文件只存一份，
+    // 5起单独树格式的条目以1字节码长表选择开头，可以改用内置静态表
+    static constexpr char kFormatVersion = 5;
+
+    // 压缩文件夹：读一遍所有文件得到直方图，由码长精确算出全局树、单独树和分组树三种方案的大小，
+    // 只编码最小的一种
+    static bool compress(const std::string& folderPath, const CompressOptions& options = CompressOptions()) {
         std::string outputFile = folderPath + ".huf";
         std::cout << "正在压缩文件夹: " << folderPath << " -> " << outputFile << std::endl;
         
-        // 1. 收集所有文件
-        std::cout << "正在扫描文件..." << std::flush;
-        auto files = collectFiles(folderPath);
-        std::cout << "\r";
-        if (files.empty()) {
-            std::cerr << "错误：文件夹为空" << std::endl;
+        std::vector<FileEntry> files;
+        FolderScan scan;
+        ThreadPool pool(options.threads);
+        if (!prepare(folderPath, options, pool, files, scan)) {
             return false;
         }
+        return writeSmaller(outputFile, files, scan, pool, options);
+    }
+    
+    // 增量更新 <文件夹>.huf：按路径比较大小和修改时间（checkHash 时改为比较内容哈希），
+    // 未变化的文件直接复制旧的编码数据，只编码新增和修改过的文件；沿用旧压缩包的方案。
+    // 全局树和分组树方案只能沿用旧码长表，重新编码的内容出现表中没有的字符时改为完整压缩
+    static bool update(const std::string& folderPath, const CompressOptions& options = CompressOptions()) {
+        std::string archivePath = folderPath + ".huf";
+        std::string tempPath = archivePath + ".tmp";
+        std::cout << "正在更新压缩包: " << folderPath << " -> " << archivePath << std::endl;
+        if (!fs::exists(archivePath)) {
+            std::cout << "没有旧压缩包，完整压缩" << std::endl;
+            return compress(folderPath, options);
+        }
         
-        std::cout << "发现 " << files.size() << " 个文件" << std::endl;
+        bool full = false;
+        bool ok = false;
+        {
+            RandomAccessFile previous(archivePath);
+            char magic;
+            std::vector<DirectoryEntry> previousEntries;
+            if (!readDirectory(previous, magic, previousEntries)) {
+                std::cout << "无法沿用旧压缩包，完整压缩" << std::endl;
+                full = true;
+            } else {
+                ok = updateFrom(folderPath, previous, magic, previousEntries, tempPath, options, full);
+            }
+        }
         
-        // 2. 写入压缩文件
-        std::ofstream out(outputFile, std::ios::binary);
-        if (!out.is_open()) {
-            std::cerr << "错误：无法创建输出文件" << std::endl;
+        std::error_code ec;
+        if (full || !ok) {
+            fs::remove(tempPath, ec);
+            return full && compress(folderPath, options);
+        }
+        fs::rename(tempPath, archivePath, ec);
+        if (ec) {
+            std::cerr << "错误：无法替换旧压缩包 " << archivePath << std::endl;
             return false;
         }
+        return true;
+    }
+    
+    // 方案1：全局哈夫曼树（一棵树编码所有文件）
+    static bool compressWithGlobalTree(const std::string& folderPath, const CompressOptions& options = CompressOptions()) {
+        std::string outputFile = folderPath + ".huf";
+        std::cout << "正在压缩文件夹: " << folderPath << " -> " << outputFile << std::endl;
         
-        // 写入魔数标识（单独树模式）
-        out.put('S');
-        
-        // 写入文件数量
-        VarInt::write(out, files.size());
+        std::vector<FileEntry> files;
+        FolderScan scan;
+        ThreadPool pool(options.threads);
+        if (!prepare(folderPath, options, pool, files, scan)) {
+            return false;
+        }
         
-        // 3. 逐个文件压缩
-        uint64_t totalOriginalSize = 0;
-        uint64_t totalCompressedSize = 4 + VarInt::encodedSize(files.size());
+        HuffmanTree globalTree;
+        {
+            Stats::Timer timer(options.stats, Stats::kTreeBuild);
+            buildTree(scan.globalCounts, scan.maxCodeLength, globalTree);
+        }
+        if (!writeGlobal(outputFile, files, scan, globalTree, pool)) {
+            return false;
+        }
+        printStats(outputFile, scan.originalSize, options.stats);
+        return true;
+    }
+    
+    // 方案2：单独哈夫曼树（每个文件一棵树）
+    static bool compressWithSeparateTrees(const std::string& folderPath, const CompressOptions& options = CompressOptions()) {
+        std::string outputFile = folderPath + ".huf";
+        std::cout << "正在压缩文件夹: " << folderPath << " -> " << outputFile << std::endl;
         
-        for (const auto& file : files) {
-            std::cout << "  压缩: " << file.relativePath << " (" << file.size << "字节)" << std::endl;
-            
-            // 读取文件内容
-            std::string content = readFileContent(file.absolutePath);
-            
-            // 为这个文件单独构建哈夫曼树（包含路径和内容的所有字符）
-            auto charFreqs = getFrequencies(file.relativePath + content);
-            
-            HuffmanTree tree;
-            tree.buildFromFrequencies(charFreqs);
-            tree.generateCodeTable();
-            
-            // 写入这个文件的哈夫曼树
-            size_t treeStartPos = out.tellp();
-            BitWriter treeWriter(out);
-            TreeSerializer::serialize(tree.getRoot(), treeWriter);
-            treeWriter.flush();
-            size_t treeEndPos = out.tellp();
-            
-            // 编码路径和内容
-            std::string encodedPath = tree.encode(file.relativePath);
-            std::string encodedContent = tree.encode(content);
-            
-            // 写入编码后的路径长度和内容长度（位数）
-            VarInt::write(out, encodedPath.length());
-            VarInt::write(out, encodedContent.length());
-            
-            // 写入编码后的路径数据
-            for (size_t i = 0; i < encodedPath.length(); i += 8) {
-                std::bitset<8> byte;
-                for (int j = 0; j < 8 && i + j < encodedPath.length(); j++) {
-                    if (encodedPath[i + j] == '1') {
-                        byte[7 - j] = 1;
-                    }
-                }
-                unsigned char byteValue = static_cast<unsigned char>(byte.to_ulong());
-                out.put(byteValue);
-            }
-            
-            // 写入编码后的内容数据
-            for (size_t i = 0; i < encodedContent.length(); i += 8) {
-                std::bitset<8> byte;
-                for (int j = 0; j < 8 && i + j < encodedContent.length(); j++) {
-                    if (encodedContent[i + j] == '1') {
-                        byte[7 - j] = 1;
-                    }
-                }
-                unsigned char byteValue = static_cast<unsigned char>(byte.to_ulong());
-                out.put(byteValue);
-            }
-            
-            totalOriginalSize += file.relativePath.length() + file.size;
-            totalCompressedSize += (treeEndPos - treeStartPos)
-                                 + VarInt::encodedSize(encodedPath.length())
-                                 + VarInt::encodedSize(encodedContent.length())
-                                 + (encodedPath.length() + 7) / 8
-                                 + (encodedContent.length() + 7) / 8;
-                                 + (encodedContent.length() + 7) / 8;
+        std::vector<FileEntry> files;
+        FolderScan scan;
+        ThreadPool pool(options.threads);
+        if (!prepare(folderPath, options, pool, files, scan)) {
+            return false;
         }
         
-        out.close();
+        std::vector<EntryTable> tables;
+        chooseEntryTables(files, scan, pool, tables);
+        if (!writeSeparate(outputFile, files, scan, tables, pool)) {
+            return false;
+        }
+        printStats(outputFile, scan.originalSize, options.stats);
+        return true;
+    }
+    
+    // 方案3：分组哈夫曼树（按直方图把文件分成几组，每组一棵树）
+    static bool compressWithClusteredTrees(const std::string& folderPath, const CompressOptions& options = CompressOptions()) {
+        std::string outputFile = folderPath + ".huf";
+        std::cout << "正在压缩文件夹: " << folderPath << " -> " << outputFile << std::endl;
         
-        // 4. 统计信息
-        uint64_t compressedSize = fs::file_size(outputFile);
-        std::cout << "\n压缩完成！" << std::endl;
-        std::cout << "原始大小: " << totalOriginalSize << " 字节" << std::endl;
-        std::cout << "压缩后大小: " << compressedSize << " 字节" << std::endl;
-        std::cout << "压缩率: " << (1.0 - (double)compressedSize / totalOriginalSize) * 100 << "%" << std::endl;
+        std::vector<FileEntry> files;
+        FolderScan scan;
+        ThreadPool pool(options.threads);
+        if (!prepare(folderPath, options, pool, files, scan)) {
+            return false;
+        }
         
+        Clustering clustering;
+        {
+            Stats::Timer timer(options.stats, Stats::kTreeBuild);
+            clustering = clusterFiles(files, scan, pool);
+        }
+        std::cout << "分为 " << clustering.tables.size() << " 组" << std::endl;
+        if (!writeClustered(outputFile, files, scan, clustering, pool)) {
+            return false;
+        }
+        printStats(outputFile, scan.originalSize, options.stats);
         return true;
     }
     
-    // 解压全局树格式
-    static bool decompressGlobal(const std::string& archivePath) {
+    // 解压全局树格式（'G'旧格式 / 'g'规范码长格式）
+    static bool decompressGlobal(const std::string& archivePath, const CompressOptions& options = CompressOptions()) {
         std::ifstream in(archivePath, std::ios::binary);
         if (!in.is_open()) {
             std::cerr << "错误：无法打开压缩文件" << std::endl;
@@ -297,64 +1790,74 @@ public:
         // 验证魔数
         char magic;
         in.get(magic);
-        if (magic != 'G') {
+        if (magic != 'G' && magic != 'g') {
             std::cerr << "错误：不是全局树格式" << std::endl;
             return false;
         }
+        bool canonical = (magic == 'g');
+        int version = 0;
+        if (canonical && !checkVersion(in, version)) {
+            return false;
+        }
+        if (version >= kDirectoryVersion) {
+            in.close();
+            return decompressIndexed(archivePath, options);
+        }
         
-        // 读取全局哈夫曼树
-        BitReader treeReader(in);
-        HuffmanNode* root = TreeSerializer::deserialize(treeReader);
-        if (!root) {
-            std::cerr << "错误：无法读取哈夫曼树" << std::endl;
+        // 读取全局编码表，只需构建一次解码表
+        HuffmanDecoder decoder;
+        if (!readDecoder(in, canonical, decoder)) {
             return false;
         }
         
         // 读取文件数量
-        uint32_t fileCount = VarInt::decode(in);
+        uint64_t fileCount = VarInt::decode(in);
         std::cout << "解压 " << fileCount << " 个文件" << std::endl;
         
-        // 提取输出目录名
-        std::string outputFolder = archivePath;
-        size_t pos = outputFolder.find(".huf");
-        if (pos != std::string::npos) {
-            outputFolder = outputFolder.substr(0, pos);
-        }
+        std::string outputFolder = outputFolderFor(archivePath);
         
         // 解压每个文件
-        for (uint32_t i = 0; i < fileCount; i++) {
-            // 读取元数据（VarInt编码的位数，用于验证）
-            uint32_t pathBits = VarInt::decode(in);
-            uint32_t contentBits = VarInt::decode(in);
-            
-            // 读取并解码路径（readBits会自动读取4字节bitCount）
-            std::string encodedPath = FileCompressor::readBits(in);
-            std::string relativePath = HuffmanTree::decodeWithRoot(root, encodedPath);
+        for (uint64_t i = 0; i < fileCount; i++) {
+            // 读取元数据（VarInt编码的位数）
+            uint64_t pathBits = VarInt::decode(in);
+            uint64_t contentBits = VarInt::decode(in);
             
-            // 读取并解码内容（readBits会自动读取4字节bitCount）
-            std::string encodedContent = FileCompressor::readBits(in);
-            std::string content = HuffmanTree::decodeWithRoot(root, encodedContent);
-            
-            // 创建目录并写入文件
-            fs::path targetPath = fs::path(outputFolder) / relativePath;
-            fs::create_directories(targetPath.parent_path());
-            
-            std::ofstream outFile(targetPath, std::ios::binary);
-            outFile << content;
-            outFile.close();
+            std::string relativePath;
+            std::string content;
+            Stats::FileStats* fileStats = nullptr;
+            if (canonical) {
+                fileStats = addFileStats(options.stats, pathBits, contentBits);
+                if (!readEntry(in, decoder, pathBits, contentBits, relativePath, content, options.stats, fileStats)) {
+                    return false;
+                }
+            } else {
+                // 旧格式的路径和内容前各有一个4字节bitCount
+                fileStats = addFileStats(options.stats, 0, 0);
+                Stats::Timer timer(options.stats, Stats::kDecode, fileStats != nullptr ? &fileStats->seconds : nullptr);
+                std::vector<uint8_t> encoded;
+                int bitCount = 0;
+                if (!FileCompressor::readBitCount(in, bitCount) ||
+                    !FileCompressor::readPackedBits(in, bitCount, encoded) ||
+                    !decoder.decode(encoded, bitCount, relativePath) ||
+                    !FileCompressor::readBitCount(in, bitCount) ||
+                    !FileCompressor::readPackedBits(in, bitCount, encoded) ||
+                    !decoder.decode(encoded, bitCount, content)) {
+                    return false;
+                }
+            }
             
-            std::cout << "  解压: " << relativePath << " (" << content.size() << "字节)" << std::endl;
+            writeEntry(outputFolder, relativePath, content, options.stats, fileStats);
         }
         
-        delete root;
         in.close();
+        recordTotals(options.stats, archivePath);
         
         std::cout << "解压完成！输出目录: " << outputFolder << std::endl;
         return true;
     }
     
-    // 解压单独树格式
-    static bool decompressSeparate(const std::string& archivePath) {
+    // 解压单独树格式（'S'旧格式 / 's'规范码长格式）
+    static bool decompressSeparate(const std::string& archivePath, const CompressOptions& options = CompressOptions()) {
         std::ifstream in(archivePath, std::ios::binary);
         if (!in.is_open()) {
             std::cerr << "错误：无法打开压缩文件" << std::endl;
@@ -364,121 +1867,203 @@ public:
         // 验证魔数
         char magic;
         in.get(magic);
-        if (magic != 'S') {
+        if (magic != 'S' && magic != 's') {
             std::cerr << "错误：不是单独树格式" << std::endl;
             return false;
         }
+        bool canonical = (magic == 's');
+        int version = 0;
+        if (canonical && !checkVersion(in, version)) {
+            return false;
+        }
+        if (version >= kDirectoryVersion) {
+            in.close();
+            return decompressIndexed(archivePath, options);
+        }
         
         // 读取文件数量
-        uint32_t fileCount = VarInt::decode(in);
+        uint64_t fileCount = VarInt::decode(in);
         std::cout << "解压 " << fileCount << " 个文件" << std::endl;
         
-        // 提取输出目录名
-        std::string outputFolder = archivePath;
-        size_t pos = outputFolder.find(".huf");
-        if (pos != std::string::npos) {
-            outputFolder = outputFolder.substr(0, pos);
-        }
+        std::string outputFolder = outputFolderFor(archivePath);
         
         // 解压每个文件
-        for (uint32_t i = 0; i < fileCount; i++) {
-            // 读取这个文件的哈夫曼树
-            BitReader treeReader(in);
-            HuffmanNode* root = TreeSerializer::deserialize(treeReader);
+        HuffmanDecoder decoder;
+        for (uint64_t i = 0; i < fileCount; i++) {
+            // 读取这个文件的编码表
+            if (!readDecoder(in, canonical, decoder)) {
+                return false;
+            }
             
             // 读取编码后的路径长度和内容长度
-            uint32_t pathBits = VarInt::decode(in);
-            uint32_t contentBits = VarInt::decode(in);
-            
-            // 读取并解码路径
-            std::string encodedPath = FileCompressor::readBits(in, pathBits);
-            std::string relativePath = HuffmanTree::decodeWithRoot(root, encodedPath);
-            
-            // 读取并解码内容
-            std::string encodedContent = FileCompressor::readBits(in, contentBits);
-            std::string content = HuffmanTree::decodeWithRoot(root, encodedContent);
-            
-            // 创建目录并写入文件
-            fs::path targetPath = fs::path(outputFolder) / relativePath;
-            fs::create_directories(targetPath.parent_path());
-            
-            std::ofstream outFile(targetPath, std::ios::binary);
-            outFile << content;
-            outFile.close();
+            uint64_t pathBits = VarInt::decode(in);
+            uint64_t contentBits = VarInt::decode(in);
             
-            std::cout << "  解压: " << relativePath << " (" << content.size() << "字节)" << std::endl;
+            // 读取并解码路径和内容
+            std::string relativePath;
+            std::string content;
+            Stats::FileStats* fileStats = addFileStats(options.stats, pathBits, contentBits);
+            if (!readEntry(in, decoder, pathBits, contentBits, relativePath, content, options.stats, fileStats)) {
+                return false;
+            }
             
-            delete root;
+            writeEntry(outputFolder, relativePath, content, options.stats, fileStats);
         }
         
         in.close();
+        recordTotals(options.stats, archivePath);
         
         std::cout << "解压完成！输出目录: " << outputFolder << std::endl;
         return true;
     }
     
-    // 自动检测格式并解压
-    static bool decompress(const std::string& archivePath) {
+    // 解压分组树格式（'k'），这个格式总是附带中央目录
+    static bool decompressClustered(const std::string& archivePath, const CompressOptions& options = CompressOptions()) {
         std::ifstream in(archivePath, std::ios::binary);
         if (!in.is_open()) {
             std::cerr << "错误：无法打开压缩文件" << std::endl;
             return false;
         }
         
+        // 验证魔数
         char magic;
         in.get(magic);
-        in.close();
-        
-        if (magic == 'G') {
-            return decompressGlobal(archivePath);
-        } else if (magic == 'S') {
-            return decompressSeparate(archivePath);
-        } else if (magic == 'F') {
-            std::cerr << "错误：这是单文件压缩格式，请使用单文件解压命令" << std::endl;
+        if (magic != 'k') {
+            std::cerr << "错误：不是分组树格式" << std::endl;
             return false;
-        } else {
-            std::cerr << "错误：未知的压缩格式" << std::endl;
+        }
+        int version = 0;
+        if (!checkVersion(in, version)) {
             return false;
         }
+        in.close();
+        return decompressIndexed(archivePath, options);
     }
     
-    // FileCompressor的静态方法需要公开
-    static void writeBits(const std::string& bits, std::ofstream& out) {
-        int bitCount = bits.length();
-        out.write(reinterpret_cast<const char*>(&bitCount), sizeof(bitCount));
+    // 列出压缩包中的文件（只读取中央目录）
+    static bool list(const std::string& archivePath) {
+        RandomAccessFile in(archivePath);
+        char magic;
+        std::vector<DirectoryEntry> entries;
+        if (!readDirectory(in, magic, entries)) {
+            return false;
+        }
         
-        for (size_t i = 0; i < bits.length(); i += 8) {
-            std::bitset<8> byte;
-            for (int j = 0; j < 8 && i + j < bits.length(); j++) {
-                if (bits[i + j] == '1') {
-                    byte[7 - j] = 1;
-                }
+        uint64_t totalSize = 0;
+        for (const auto& entry : entries) {
+            uint64_t compressedSize = (entry.pathBits + 7) / 8 + (entry.contentBits + 7) / 8;
+            std::cout << std::setw(12) << entry.originalSize << "  " << std::setw(12) << compressedSize
+                      << "  " << entry.path;
+            if (entry.duplicateOf != kUnique) {
+                std::cout << "  （与 " << entries[entry.duplicateOf].path << " 相同）";
             }
-            unsigned char byteValue = static_cast<unsigned char>(byte.to_ulong());
-            out.put(byteValue);
+            std::cout << std::endl;
+            totalSize += entry.originalSize;
         }
+        std::cout << "共 " << entries.size() << " 个文件，" << totalSize << " 字节（"
+                  << (magic == 'g' ? "全局树" : magic == 'k' ? "分组树" : "单独树") << "）" << std::endl;
+        return true;
     }
     
-    static std::string readBits(std::ifstream& in, uint32_t bitCount) {
-        std::string bits;
-        int bytesToRead = (bitCount + 7) / 8;
+    // 只解压一个文件：由中央目录直接定位到它的码长表和编码数据
+    static bool extract(const std::string& archivePath, const std::string& path) {
+        RandomAccessFile in(archivePath);
+        char magic;
+        std::vector<DirectoryEntry> entries;
+        if (!readDirectory(in, magic, entries)) {
+            return false;
+        }
         
-        for (int i = 0; i < bytesToRead; i++) {
-            char byte;
-            if (!in.get(byte)) {
-                break;
-            }
-            
-            unsigned char ubyte = static_cast<unsigned char>(byte);
-            std::bitset<8> bitset(ubyte);
-            
-            for (int j = 7; j >= 0; j--) {
-                if (bits.length() < bitCount) {
-                    bits += (bitset[j] ? '1' : '0');
-                }
+        auto found = std::find_if(entries.begin(), entries.end(),
+                                  [&](const DirectoryEntry& entry) { return entry.path == path; });
+        if (found == entries.end()) {
+            std::cerr << "错误：压缩包中没有 " << path << std::endl;
+            return false;
+        }
+        
+        // 重复文件的内容在第一份的条目里，由 decodeEntry 一并解码
+        std::string content;
+        if (!decodeEntry(in, entries, static_cast<size_t>(found - entries.begin()), {}, &content, nullptr)) {
+            std::cerr << "错误：文件数据与中央目录不一致" << std::endl;
+            return false;
+        }
+        
+        std::string outputFolder = outputFolderFor(archivePath);
+        writeEntry(outputFolder, path, content);
+        std::cout << "输出目录: " << outputFolder << std::endl;
+        return true;
+    }
+    
+    // 测试压缩包（-t）：由中央目录并行解码每个条目并核对内容哈希，不写出文件
+    // 版本4之前的压缩包没有内容哈希，只检查能否解码以及路径和大小是否与目录一致
+    static bool test(const std::string& archivePath, const CompressOptions& options = CompressOptions()) {
+        RandomAccessFile in(archivePath);
+        char magic;
+        std::vector<DirectoryEntry> entries;
+        if (!readDirectory(in, magic, entries)) {
+            return false;
+        }
+        std::cout << "正在测试: " << archivePath << "（" << entries.size() << " 个文件）" << std::endl;
+        
+        std::unordered_map<uint64_t, HuffmanDecoder> shared;
+        if (!loadSharedDecoders(in, magic, entries, shared)) {
+            return false;
+        }
+        
+        ThreadPool pool(options.threads);
+        std::vector<char> passed(entries.size(), 0);
+        pool.parallelFor(entries.size(), [&](size_t i) {
+            passed[i] = decodeEntry(in, entries, i, shared, nullptr, options.stats);
+        });
+        
+        size_t brokenCount = 0;
+        uint64_t totalSize = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (!passed[i]) {
+                std::cerr << "  损坏: " << entries[i].path << std::endl;
+                brokenCount++;
             }
+            totalSize += entries[i].originalSize;
+        }
+        if (options.stats != nullptr) {
+            options.stats->bytesIn = in.size();
+            options.stats->bytesOut = totalSize;
+        }
+        if (brokenCount > 0) {
+            std::cerr << "测试失败：" << brokenCount << " 个文件已损坏" << std::endl;
+            return false;
+        }
+        bool tracked = std::all_of(entries.begin(), entries.end(),
+                                   [](const DirectoryEntry& entry) { return entry.tracked; });
+        std::cout << "测试通过：" << entries.size() << " 个文件，" << totalSize << " 字节"
+                  << (tracked ? "，内容哈希全部一致" : "（旧版本没有内容哈希，只检查了能否解码）") << std::endl;
+        return true;
+    }
+    
+    // 自动检测格式并解压
+    static bool decompress(const std::string& archivePath, const CompressOptions& options = CompressOptions()) {
+        std::ifstream in(archivePath, std::ios::binary);
+        if (!in.is_open()) {
+            std::cerr << "错误：无法打开压缩文件" << std::endl;
+            return false;
         }
         
-        return bits;
+        char magic;
+        in.get(magic);
+        in.close();
+        
+        if (magic == 'G' || magic == 'g') {
+            return decompressGlobal(archivePath, options);
+        } else if (magic == 'S' || magic == 's') {
+            return decompressSeparate(archivePath, options);
+        } else if (magic == 'k') {
+            return decompressClustered(archivePath, options);
+        } else if (magic == 'F' || magic == 'f') {
+            std::cerr << "错误：这是单文件压缩格式，请使用单文件解压命令" << std::endl;
+            return false;
+        } else {
+            std::cerr << "错误：未知的压缩格式" << std::endl;
+            return false;
+        }
     }
 };
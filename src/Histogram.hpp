@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// 字节直方图：所有压缩路径共用的频率统计
+// 用4组交错的子直方图轮流计数，相邻字节落在不同的计数数组上，
+// 连续相同字节时不会因为同一计数器的"写后读"而串行等待；
+// 每次读入8字节再逐字节拆分，循环展开，单核可达数GB/s。
+class Histogram {
+public:
+    using Counts = std::array<uint64_t, 256>;
+
+private:
+    static constexpr int kLanes = 4;
+    // 子直方图用32位计数，每处理这么多字节就并入64位总数，保证不会溢出
+    static constexpr size_t kFlushInterval = size_t(1) << 30;
+
+    using Lanes = std::array<std::array<uint32_t, 256>, kLanes>;
+
+    static void countChunk(const uint8_t* p, size_t size, Lanes& lanes) {
+        const uint8_t* end = p + size;
+
+        while (end - p >= 16) {
+            uint64_t a, b;
+            std::memcpy(&a, p, 8);
+            std::memcpy(&b, p + 8, 8);
+            p += 16;
+
+            lanes[0][a & 0xFF]++;
+            lanes[1][(a >> 8) & 0xFF]++;
+            lanes[2][(a >> 16) & 0xFF]++;
+            lanes[3][(a >> 24) & 0xFF]++;
+            lanes[0][(a >> 32) & 0xFF]++;
+            lanes[1][(a >> 40) & 0xFF]++;
+            lanes[2][(a >> 48) & 0xFF]++;
+            lanes[3][a >> 56]++;
+
+            lanes[0][b & 0xFF]++;
+            lanes[1][(b >> 8) & 0xFF]++;
+            lanes[2][(b >> 16) & 0xFF]++;
+            lanes[3][(b >> 24) & 0xFF]++;
+            lanes[0][(b >> 32) & 0xFF]++;
+            lanes[1][(b >> 40) & 0xFF]++;
+            lanes[2][(b >> 48) & 0xFF]++;
+            lanes[3][b >> 56]++;
+        }
+        while (p < end) {
+            lanes[0][*p++]++;
+        }
+    }
+
+public:
+    // 把 data 中 size 个字节的计数累加到 counts
+    static void accumulate(const char* data, size_t size, Counts& counts) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+
+        // 很短的输入（如路径）直接计数，省去清零子直方图的开销
+        if (size < 256) {
+            for (size_t i = 0; i < size; i++) {
+                counts[p[i]]++;
+            }
+            return;
+        }
+
+        Lanes lanes;
+        while (size > 0) {
+            size_t chunk = std::min(size, kFlushInterval);
+            for (auto& lane : lanes) lane.fill(0);
+            countChunk(p, chunk, lanes);
+            for (int symbol = 0; symbol < 256; symbol++) {
+                counts[symbol] += uint64_t(lanes[0][symbol]) + lanes[1][symbol] + lanes[2][symbol] + lanes[3][symbol];
+            }
+            p += chunk;
+            size -= chunk;
+        }
+    }
+
+    static void accumulate(const std::string& text, Counts& counts) {
+        accumulate(text.data(), text.size(), counts);
+    }
+
+    static Counts count(const char* data, size_t size) {
+        Counts counts{};
+        accumulate(data, size, counts);
+        return counts;
+    }
+
+    // 合并两个直方图
+    static void merge(Counts& into, const Counts& from) {
+        for (int symbol = 0; symbol < 256; symbol++) {
+            into[symbol] += from[symbol];
+        }
+    }
+
+    // 出现过的字节种数
+    static int distinct(const Counts& counts) {
+        return static_cast<int>(std::count_if(counts.begin(), counts.end(), [](uint64_t c) { return c > 0; }));
+    }
+
+    // 转为建树所需的（字符，频率）列表，按字节值递增，只含出现过的字节
+    static std::vector<std::pair<char, uint64_t>> toFrequencies(const Counts& counts) {
+        std::vector<std::pair<char, uint64_t>> charFreqs;
+        for (int symbol = 0; symbol < 256; symbol++) {
+            if (counts[symbol] > 0) {
+                charFreqs.push_back({static_cast<char>(symbol), counts[symbol]});
+            }
+        }
+        return charFreqs;
+    }
+};
@@ -0,0 +1,416 @@
+#pragma once
+
+#include "HuffmanNode.hpp"
+#include "BitStream.hpp"
+#include "CanonicalCode.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+#include <cstddef>
+
+// 查表式哈夫曼解码器
+// 一级表用接下来的 rootBits 位直接查出符号和码长；更长的码在一级表中
+// 记录一个子表链接，再用后续位查子表，任意深度的树都能处理。
+class HuffmanDecoder {
+public:
+    static constexpr int kMaxTableBits = 11;  // 单张表最多索引的位数（2048项，常驻L1）
+
+private:
+    // 表项布局：
+    //   bit 0-4  叶子：本表内消费的位数；链接：子表的索引位数
+    //   bit 5    1 表示子表链接
+    //   bit 8-31 叶子：符号值；链接：子表起始下标
+    // 全0表示无效码
+    static constexpr uint32_t kLinkFlag = 0x20;
+
+    std::vector<uint32_t> table;
+    int rootBits;
+
+    static uint32_t makeLeaf(unsigned char symbol, int length) {
+        return (uint32_t(symbol) << 8) | uint32_t(length);
+    }
+
+    static uint32_t makeLink(size_t offset, int bits) {
+        return (uint32_t(offset) << 8) | kLinkFlag | uint32_t(bits);
+    }
+
+    // 分配一张索引 bits 位的表，返回起始下标
+    size_t allocateTable(int bits) {
+        size_t base = table.size();
+        table.resize(base + (size_t(1) << bits), 0);
+        return base;
+    }
+
+    // 码字（左对齐到64位，便于按前缀分组）
+    struct AlignedCode {
+        uint64_t bits;
+        int length;
+        unsigned char symbol;
+    };
+
+    // 把 codes[first, last) 填进表：这些码的前 consumed 位已在上级表中消费
+    void fillFromCodes(const std::vector<AlignedCode>& codes, size_t first, size_t last,
+                       size_t base, int bits, int consumed) {
+        size_t i = first;
+        while (i < last) {
+            const AlignedCode& code = codes[i];
+            size_t index = static_cast<size_t>((code.bits << consumed) >> (64 - bits));
+            int rest = code.length - consumed;
+
+            if (rest <= bits) {
+                std::fill(table.begin() + base + index,
+                          table.begin() + base + index + (size_t(1) << (bits - rest)),
+                          makeLeaf(code.symbol, rest));
+                i++;
+                continue;
+            }
+
+            // 本表索引相同的长码在排序后相邻，一起放进子表
+            size_t groupEnd = i;
+            int longest = 0;
+            while (groupEnd < last &&
+                   static_cast<size_t>((codes[groupEnd].bits << consumed) >> (64 - bits)) == index) {
+                longest = std::max(longest, codes[groupEnd].length);
+                groupEnd++;
+            }
+            int subBits = std::min(longest - consumed - bits, kMaxTableBits);
+            size_t subBase = allocateTable(subBits);
+            table[base + index] = makeLink(subBase, subBits);
+            fillFromCodes(codes, i, groupEnd, subBase, subBits, consumed + bits);
+            i = groupEnd;
+        }
+    }
+
+    // 由左对齐的码字构建多级表
+    void buildFromAligned(std::vector<AlignedCode>& aligned) {
+        if (aligned.empty()) return;
+        int longest = 0;
+        for (const auto& code : aligned) {
+            longest = std::max(longest, code.length);
+        }
+
+        std::sort(aligned.begin(), aligned.end(), [](const AlignedCode& a, const AlignedCode& b) {
+            return a.bits < b.bits;
+        });
+
+        rootBits = std::min(longest, kMaxTableBits);
+        allocateTable(rootBits);
+        fillFromCodes(aligned, 0, aligned.size(), 0, rootBits, 0);
+    }
+
+    static constexpr int kIncomplete = -1;
+    static constexpr int kInvalid = -2;
+
+    // 逐级查表解码一个符号；剩余位数不足返回 kIncomplete，码非法返回 kInvalid
+    int decodeSymbol(PackedBitReader& reader, uint64_t& remaining) const {
+        size_t base = 0;
+        int bits = rootBits;
+
+        while (true) {
+            if (reader.available() < bits) reader.refill();
+            uint32_t entry = table[base + reader.peek(bits)];
+            int length = entry & 0x1F;
+
+            if (entry & kLinkFlag) {
+                if (static_cast<uint64_t>(bits) > remaining) return kIncomplete;
+                reader.consume(bits);
+                remaining -= bits;
+                base = entry >> 8;
+                bits = length;
+                continue;
+            }
+
+            if (length == 0) return kInvalid;
+            if (static_cast<uint64_t>(length) > remaining) return kIncomplete;
+            reader.consume(length);
+            remaining -= length;
+            return static_cast<int>((entry >> 8) & 0xFF);
+        }
+    }
+
+    static constexpr size_t kInterleave = 4;      // 快速路径中同时推进的子流数
+    static constexpr size_t kBatchSymbols = 4;    // 每轮每条流解码的符号数（一级表命中时共44位以内）
+    static constexpr uint64_t kBatchBits = 128;   // 每轮开始时每条流至少剩余的位数（补充时后面至少还有8字节）
+
+    // 交错解码的快速路径：kInterleave 条流都还剩足够的位和符号时，每轮各补充一次缓冲，
+    // 再轮流从各流解 kBatchSymbols 个符号
+    // 只处理一级表直接命中的码；遇到长码或非法码时停下，返回这条流的序号，由调用方逐级查表解出
+    // 这一个符号后再回来；空间不足一轮时返回 kInterleave
+    // 四条流的读取器和输出位置都放在独立的局部变量里，写输出时不必担心别名，状态可以留在寄存器里
+    // 每轮开始时剩余位数不少于 kBatchBits，补充不会读到数据末尾之外，可以不检查边界
+    size_t decodeBatches(PackedBitReader* readers, const uint64_t* bitCounts, char** cursors,
+                         char* const* ends) const {
+        static_assert(kInterleave == 4, "快速路径按4条流展开");
+        PackedBitReader r0 = readers[0], r1 = readers[1], r2 = readers[2], r3 = readers[3];
+        char* c0 = cursors[0];
+        char* c1 = cursors[1];
+        char* c2 = cursors[2];
+        char* c3 = cursors[3];
+        const uint32_t* entries = table.data();
+        const int bits = rootBits;
+
+        auto step = [entries, bits](PackedBitReader& reader, char*& cursor) {
+            uint32_t entry = entries[reader.peek(bits)];
+            int length = entry & 0x1F;
+            if ((entry & kLinkFlag) || length == 0) return false;
+            reader.consume(length);
+            *cursor++ = static_cast<char>((entry >> 8) & 0xFF);
+            return true;
+        };
+
+        size_t stopped = kInterleave;
+        while (stopped == kInterleave &&
+               c0 + kBatchSymbols <= ends[0] && c1 + kBatchSymbols <= ends[1] &&
+               c2 + kBatchSymbols <= ends[2] && c3 + kBatchSymbols <= ends[3] &&
+               r0.bitsConsumed() + kBatchBits <= bitCounts[0] && r1.bitsConsumed() + kBatchBits <= bitCounts[1] &&
+               r2.bitsConsumed() + kBatchBits <= bitCounts[2] && r3.bitsConsumed() + kBatchBits <= bitCounts[3]) {
+            r0.refillFast();
+            r1.refillFast();
+            r2.refillFast();
+            r3.refillFast();
+            for (size_t k = 0; k < kBatchSymbols; k++) {
+                if (!step(r0, c0)) { stopped = 0; break; }
+                if (!step(r1, c1)) { stopped = 1; break; }
+                if (!step(r2, c2)) { stopped = 2; break; }
+                if (!step(r3, c3)) { stopped = 3; break; }
+            }
+        }
+
+        readers[0] = r0;
+        readers[1] = r1;
+        readers[2] = r2;
+        readers[3] = r3;
+        cursors[0] = c0;
+        cursors[1] = c1;
+        cursors[2] = c2;
+        cursors[3] = c3;
+        return stopped;
+    }
+
+    // 单条流解码到 [cursor, end)：位数充足时每次补充后连续解 kBatchSymbols 个一级表命中的符号，
+    // 长码和数据末尾逐级查表
+    bool decodeSingle(PackedBitReader& reader, uint64_t bitCount, char*& cursor, char* end) const {
+        const uint32_t* entries = table.data();
+        while (cursor < end) {
+            if (reader.bitsConsumed() + kBatchBits <= bitCount && size_t(end - cursor) >= kBatchSymbols) {
+                reader.refillFast();
+                size_t k = 0;
+                for (; k < kBatchSymbols; k++) {
+                    uint32_t entry = entries[reader.peek(rootBits)];
+                    int length = entry & 0x1F;
+                    if ((entry & kLinkFlag) || length == 0) break;
+                    reader.consume(length);
+                    *cursor++ = static_cast<char>((entry >> 8) & 0xFF);
+                }
+                if (k == kBatchSymbols) continue;
+            }
+            if (!decodeOne(reader, bitCount, cursor)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 逐级查表解码流中的一个符号，写到 cursor；出错时报告并返回 false
+    bool decodeOne(PackedBitReader& reader, uint64_t bitCount, char*& cursor) const {
+        uint64_t consumed = reader.bitsConsumed();
+        uint64_t remaining = consumed <= bitCount ? bitCount - consumed : 0;
+        int symbol = decodeSymbol(reader, remaining);
+        if (symbol < 0) {
+            std::cerr << (symbol == kInvalid ? "错误：无效的编码路径" : "错误：编码数据不完整") << std::endl;
+            return false;
+        }
+        *cursor++ = static_cast<char>(symbol);
+        return true;
+    }
+
+public:
+    HuffmanDecoder() : rootBits(0) {}
+
+    // 从哈夫曼树构建解码表
+    explicit HuffmanDecoder(const HuffmanNodeArena& tree) : rootBits(0) {
+        buildFromTree(tree);
+    }
+
+    // 按树的形状构建（旧格式的树不一定是规范码）：收集各叶子的码字后与规范码走同一条建表路径
+    // 树过深时解码表为空
+    void buildFromTree(const HuffmanNodeArena& tree) {
+        table.clear();
+        rootBits = 0;
+
+        std::vector<AlignedCode> aligned;
+        bool ok = tree.forEachLeaf([&aligned](char character, uint64_t code, int length) {
+            // 只有一种字符时编码器为它分配码"0"
+            if (length == 0) length = 1;
+            aligned.push_back({code << (64 - length), length, static_cast<unsigned char>(character)});
+        });
+        if (ok) buildFromAligned(aligned);
+    }
+
+    // 从规范码长表构建解码表，不需要指针树
+    // 码长需先经 CanonicalCode::isValid 校验
+    void buildFromLengths(const CanonicalCode::Lengths& lengths) {
+        table.clear();
+        rootBits = 0;
+
+        CanonicalCode::Codes codes = CanonicalCode::assign(lengths);
+        std::vector<AlignedCode> aligned;
+        for (int symbol = 0; symbol < 256; symbol++) {
+            int length = lengths[symbol];
+            if (length == 0) continue;
+            aligned.push_back({codes[symbol] << (64 - length), length, static_cast<unsigned char>(symbol)});
+        }
+        buildFromAligned(aligned);
+    }
+
+    bool empty() const {
+        return table.empty();
+    }
+
+    // 解码 data 中的前 bitCount 位，结果追加到 out
+    bool decode(const uint8_t* data, uint64_t bitCount, std::string& out) const {
+        if (bitCount == 0) {
+            return true;
+        }
+        if (table.empty()) {
+            std::cerr << "错误：树根为空" << std::endl;
+            return false;
+        }
+
+        PackedBitReader reader(data, (bitCount + 7) / 8);
+        uint64_t remaining = bitCount;
+
+        while (remaining > 0) {
+            // 快速路径：一次补充后连续解码多个一级表即可确定的符号
+            if (remaining >= 64) {
+                reader.refill();
+                while (reader.available() >= rootBits) {
+                    uint32_t entry = table[reader.peek(rootBits)];
+                    int length = entry & 0x1F;
+                    if ((entry & kLinkFlag) || length == 0) break;
+                    reader.consume(length);
+                    remaining -= length;
+                    out.push_back(static_cast<char>((entry >> 8) & 0xFF));
+                }
+                if (reader.available() < rootBits) continue;
+            }
+
+            // 长码、非法码或数据尾部：逐级查表并检查剩余位数
+            int symbol = decodeSymbol(reader, remaining);
+            if (symbol == kInvalid) {
+                std::cerr << "错误：无效的编码路径" << std::endl;
+                return false;
+            }
+            if (symbol == kIncomplete) {
+                std::cerr << "错误：编码数据不完整" << std::endl;
+                return false;
+            }
+            out.push_back(static_cast<char>(symbol));
+        }
+
+        return true;
+    }
+
+    bool decode(const std::vector<uint8_t>& data, uint64_t bitCount, std::string& out) const {
+        return decode(data.data(), bitCount, out);
+    }
+
+    // 解码 data 中的 bitCount 位，恰好得到 count 个符号直接写到 out；用掉的位数与 bitCount 不符时报错
+    bool decodeTo(const uint8_t* data, uint64_t bitCount, char* out, size_t count) const {
+        if (count == 0 && bitCount == 0) {
+            return true;
+        }
+        if (table.empty()) {
+            std::cerr << "错误：树根为空" << std::endl;
+            return false;
+        }
+
+        PackedBitReader reader(data, (bitCount + 7) / 8);
+        uint64_t remaining = bitCount;
+        char* cursor = out;
+        char* end = out + count;
+        while (cursor < end) {
+            // 快速路径与 decode 相同：一次补充后连续解码多个一级表即可确定的符号
+            if (remaining >= 64) {
+                reader.refill();
+                while (cursor < end && reader.available() >= rootBits) {
+                    uint32_t entry = table[reader.peek(rootBits)];
+                    int length = entry & 0x1F;
+                    if ((entry & kLinkFlag) || length == 0) break;
+                    reader.consume(length);
+                    remaining -= length;
+                    *cursor++ = static_cast<char>((entry >> 8) & 0xFF);
+                }
+                if (cursor == end || reader.available() < rootBits) continue;
+            }
+
+            int symbol = decodeSymbol(reader, remaining);
+            if (symbol < 0) {
+                std::cerr << (symbol == kInvalid ? "错误：无效的编码路径" : "错误：编码数据不完整") << std::endl;
+                return false;
+            }
+            *cursor++ = static_cast<char>(symbol);
+        }
+        if (remaining != 0) {
+            std::cerr << "错误：解码后位数与记录不一致" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // 交错解码 count 条共用这张表的子流：第 s 条流从 data[s] 开始共 bitCounts[s] 位，
+    // 解出 symbolCounts[s] 个符号写到 out[s]
+    // 每 kInterleave 条流一组，组内每轮依次从每条流各解一个符号；各流的位读取器互不依赖，
+    // 单线程内CPU也能同时推进多条"查表-移位"依赖链
+    bool decodeStreams(const uint8_t* const* data, const uint64_t* bitCounts, const size_t* symbolCounts,
+                       size_t count, char* const* out) const {
+        size_t total = 0;
+        for (size_t s = 0; s < count; s++) {
+            total += symbolCounts[s];
+        }
+        if (total == 0) {
+            return true;
+        }
+        if (table.empty()) {
+            std::cerr << "错误：树根为空" << std::endl;
+            return false;
+        }
+
+        for (size_t first = 0; first < count; first += kInterleave) {
+            size_t groupSize = std::min(kInterleave, count - first);
+            std::vector<PackedBitReader> readers;
+            std::vector<char*> cursors(out + first, out + first + groupSize);
+            std::vector<char*> ends(groupSize);
+            for (size_t s = 0; s < groupSize; s++) {
+                readers.emplace_back(data[first + s], static_cast<size_t>((bitCounts[first + s] + 7) / 8));
+                ends[s] = out[first + s] + symbolCounts[first + s];
+            }
+
+            // 满一组时先走交错的快速路径，遇到长码时单独解出这一个符号再继续
+            if (groupSize == kInterleave) {
+                size_t stopped;
+                while ((stopped = decodeBatches(readers.data(), bitCounts + first, cursors.data(), ends.data()))
+                       != kInterleave) {
+                    if (!decodeOne(readers[stopped], bitCounts[first + stopped], cursors[stopped])) {
+                        return false;
+                    }
+                }
+            }
+
+            // 剩下的尾部（以及凑不满一组的流）逐条流解码
+            for (size_t s = 0; s < groupSize; s++) {
+                if (!decodeSingle(readers[s], bitCounts[first + s], cursors[s], ends[s])) {
+                    return false;
+                }
+                if (readers[s].bitsConsumed() != bitCounts[first + s]) {
+                    std::cerr << "错误：解码后位数与记录不一致" << std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+};
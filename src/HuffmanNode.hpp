@@ -1,28 +1,116 @@
 #pragma once
 
-class HuffmanNode {
-public:
-    char character;      // 字符值（叶子节点有效）
-    int frequency;       // 频率
-    HuffmanNode* left;   // 左子节点
-    HuffmanNode* right;  // 右子节点
+#include <array>
+#include <cstdint>
+#include <cstddef>
 
-    // 构造函数
-    HuffmanNode(char ch, int freq) 
-        : character(ch), frequency(freq), left(nullptr), right(nullptr) {}
+// 哈夫曼树节点：存放在 HuffmanNodeArena 的连续数组中，子节点用16位下标引用
+struct HuffmanNode {
+    static constexpr uint16_t kNone = 0xFFFF;  // 没有子节点
 
-    // 析构函数
-    ~HuffmanNode() {
-        delete left;
-        delete right;
-    }
+    uint64_t frequency;  // 频率
+    uint16_t left;       // 左子节点下标
+    uint16_t right;      // 右子节点下标
+    char character;      // 字符值（叶子节点有效）
 
     // 判断是否为叶子节点
     bool isLeaf() const {
-        return left == nullptr && right == nullptr;
+        return left == kNone && right == kNone;
+    }
+};
+
+// 一棵哈夫曼树的全部节点
+// 256种字节值的树最多 511 个节点，容量固定在对象内部：建树和反序列化只在数组末尾追加，
+// 清空只需把计数归零，没有逐节点的 new/delete，也没有递归释放
+class HuffmanNodeArena {
+public:
+    static constexpr size_t kMaxNodes = 511;
+    static constexpr int kMaxDepth = 64;  // 码字放在64位整数中，更深的树视为无效
+
+private:
+    std::array<HuffmanNode, kMaxNodes> nodes;
+    uint16_t count = 0;
+    uint16_t rootIndex = HuffmanNode::kNone;
+
+public:
+    void clear() {
+        count = 0;
+        rootIndex = HuffmanNode::kNone;
+    }
+
+    // 追加一个叶子，返回下标；节点已满时返回 kNone
+    uint16_t addLeaf(char character, uint64_t frequency) {
+        return add({frequency, HuffmanNode::kNone, HuffmanNode::kNone, character});
+    }
+
+    // 追加一个内部节点，返回下标；节点已满时返回 kNone
+    uint16_t addInternal(uint16_t left, uint16_t right, uint64_t frequency) {
+        return add({frequency, left, right, '\0'});
+    }
+
+    uint16_t add(const HuffmanNode& node) {
+        if (count == kMaxNodes) return HuffmanNode::kNone;
+        nodes[count] = node;
+        return count++;
     }
 
-    // 禁止拷贝
-    HuffmanNode(const HuffmanNode&) = delete;
-    HuffmanNode& operator=(const HuffmanNode&) = delete;
+    HuffmanNode& operator[](uint16_t index) {
+        return nodes[index];
+    }
+
+    const HuffmanNode& operator[](uint16_t index) const {
+        return nodes[index];
+    }
+
+    uint16_t root() const {
+        return rootIndex;
+    }
+
+    void setRoot(uint16_t index) {
+        rootIndex = index;
+    }
+
+    bool empty() const {
+        return rootIndex == HuffmanNode::kNone;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // 用显式栈按先序遍历所有叶子，对每个叶子调用 fn(字符, 码字, 码长)
+    // 左分支为0、右分支为1；只有根一个叶子时码长为0
+    // 树深超过 kMaxDepth 时返回 false
+    template <typename Fn>
+    bool forEachLeaf(Fn fn) const {
+        if (empty()) return true;
+
+        struct Frame {
+            uint16_t node;
+            int depth;
+            uint64_t code;
+        };
+        std::array<Frame, kMaxNodes> stack;
+        size_t top = 0;
+        stack[top++] = {rootIndex, 0, 0};
+
+        while (top > 0) {
+            Frame frame = stack[--top];
+            const HuffmanNode& node = nodes[frame.node];
+            if (node.isLeaf()) {
+                fn(node.character, frame.code, frame.depth);
+                continue;
+            }
+            if (frame.depth >= kMaxDepth) return false;
+
+            // 先压右子树，保证左子树先被访问
+            if (node.right != HuffmanNode::kNone) {
+                stack[top++] = {node.right, frame.depth + 1, (frame.code << 1) | 1};
+            }
+            if (node.left != HuffmanNode::kNone) {
+                stack[top++] = {node.left, frame.depth + 1, frame.code << 1};
+            }
+        }
+        return true;
+    }
 };
@@ -1,107 +1,170 @@
 #pragma once
 
 #include "HuffmanNode.hpp"
-#include <queue>
+#include "HuffmanDecoder.hpp"
+#include "BitStream.hpp"
+#include "CanonicalCode.hpp"
+#include <array>
 #include <vector>
 #include <unordered_map>
 #include <string>
 #include <iostream>
+#include <algorithm>
 
 class HuffmanTree {
 private:
-    HuffmanNode* root;
-    std::unordered_map<char, std::string> codeTable;
+    HuffmanNodeArena nodes;
+    // '0'/'1'字符串形式的编码表只供 getCodeTable 和 encode(string) 使用，第一次用到时才由扁平编码表生成，
+    // 压缩路径只用扁平表，建表时不分配内存
+    mutable std::unordered_map<char, std::string> codeTable;
+    mutable bool codeTableReady = false;
 
-    // 递归生成编码表
-    void generateCodesRecursive(HuffmanNode* node, const std::string& code) {
-        if (node == nullptr) return;
-
-        if (node->isLeaf()) {
-            codeTable[node->character] = code.empty() ? "0" : code;
-            return;
-        }
-
-        generateCodesRecursive(node->left, code + "0");
-        generateCodesRecursive(node->right, code + "1");
-    }
+    // 扁平编码表：按字节值索引的码字和码长（码长0表示该字符不在树中）
+    // 频率为64位；非规范码按树形分配，树深超过64时码字放不下（见 generateCanonicalCodeTable 的处理）
+    std::array<uint64_t, 256> codeBits{};
+    std::array<uint8_t, 256> codeLengths{};
 
 public:
-    HuffmanTree() : root(nullptr) {}
-
-    ~HuffmanTree() {
-        delete root;
-    }
+    HuffmanTree() {}
 
     // 从字符频率构建哈夫曼树
-    void buildFromFrequencies(const std::vector<std::pair<char, int>>& charFreqs) {
+    // 最小堆直接建在栈上的定长数组里，节点追加到节点区，不做堆分配
+    void buildFromFrequencies(const std::vector<std::pair<char, uint64_t>>& charFreqs) {
+        nodes.clear();
         if (charFreqs.empty()) {
-            root = nullptr;
             return;
         }
 
-        // 使用优先队列（最小堆）
-        auto cmp = [](HuffmanNode* left, HuffmanNode* right) { 
-            return left->frequency > right->frequency; 
+        // 使用最小堆（按频率）
+        auto cmp = [this](uint16_t left, uint16_t right) {
+            return nodes[left].frequency > nodes[right].frequency;
         };
-        std::priority_queue<HuffmanNode*, std::vector<HuffmanNode*>, decltype(cmp)> minHeap(cmp);
+        std::array<uint16_t, 256> heap;
+        size_t heapSize = 0;
 
         // 为每个字符创建叶子节点
         for (const auto& pair : charFreqs) {
-            minHeap.push(new HuffmanNode(pair.first, pair.second));
+            heap[heapSize++] = nodes.addLeaf(pair.first, pair.second);
+            std::push_heap(heap.begin(), heap.begin() + heapSize, cmp);
         }
 
         // 构建哈夫曼树
-        while (minHeap.size() > 1) {
-            HuffmanNode* left = minHeap.top(); 
-            minHeap.pop();
-            HuffmanNode* right = minHeap.top(); 
-            minHeap.pop();
+        while (heapSize > 1) {
+            std::pop_heap(heap.begin(), heap.begin() + heapSize, cmp);
+            uint16_t left = heap[--heapSize];
+            std::pop_heap(heap.begin(), heap.begin() + heapSize, cmp);
+            uint16_t right = heap[--heapSize];
+
+            heap[heapSize++] = nodes.addInternal(left, right, nodes[left].frequency + nodes[right].frequency);
+            std::push_heap(heap.begin(), heap.begin() + heapSize, cmp);
+        }
 
-            HuffmanNode* merged = new HuffmanNode('\0', left->frequency + right->frequency);
-            merged->left = left;
-            merged->right = right;
+        nodes.setRoot(heap[0]);
+    }
+
+    // 生成编码表（按树的形状，非规范码）
+    void generateCodeTable() {
+        codeTableReady = false;
+        codeBits.fill(0);
+        codeLengths.fill(0);
+
+        nodes.forEachLeaf([this](char character, uint64_t code, int length) {
+            // 只有一种字符时分配码"0"
+            if (length == 0) length = 1;
+            unsigned char symbol = static_cast<unsigned char>(character);
+            codeBits[symbol] = code;
+            codeLengths[symbol] = static_cast<uint8_t>(length);
+        });
+    }
+
+    // 当前编码表中各字节值的码长
+    const CanonicalCode::Lengths& getCodeLengths() const {
+        return codeLengths;
+    }
+
+    // 由频率建好的树得到码长（叶子深度），再据此生成规范编码表
+    // 规范码只由码长决定，解压端无需重建树
+    // 频率悬殊到树深超过 kMaxDepth 时（64位频率下可能出现），改用叶子频率做 package-merge
+    void generateCanonicalCodeTable() {
+        CanonicalCode::Lengths lengths{};
+        bool ok = nodes.forEachLeaf([&lengths](char character, uint64_t, int length) {
+            // 只有一种字符时仍分配1位码
+            lengths[static_cast<unsigned char>(character)] = static_cast<uint8_t>(length == 0 ? 1 : length);
+        });
+        if (!ok) {
+            std::array<uint64_t, 256> counts{};
+            for (uint16_t i = 0; i < nodes.size(); i++) {
+                if (nodes[i].isLeaf()) counts[static_cast<unsigned char>(nodes[i].character)] = nodes[i].frequency;
+            }
+            buildFromCodeLengths(CanonicalCode::packageMerge(counts, CanonicalCode::kMaxCodeLength));
+            return;
+        }
+        CanonicalCode::limit(lengths, CanonicalCode::kMaxCodeLength);
+        buildFromCodeLengths(lengths);
+    }
 
-            minHeap.push(merged);
+    // 由按字节值索引的频率直接生成规范编码表
+    // maxCodeLength 为0时按频率建哈夫曼树；否则用 package-merge 求码长受限的最优码
+    void buildFromCounts(const std::array<uint64_t, 256>& counts, int maxCodeLength = 0) {
+        if (maxCodeLength > 0) {
+            nodes.clear();
+            buildFromCodeLengths(CanonicalCode::packageMerge(counts, maxCodeLength));
+            return;
         }
 
-        root = minHeap.top();
+        std::vector<std::pair<char, uint64_t>> charFreqs;
+        for (int symbol = 0; symbol < 256; symbol++) {
+            if (counts[symbol] > 0) {
+                charFreqs.push_back({static_cast<char>(symbol), counts[symbol]});
+            }
+        }
+        buildFromFrequencies(charFreqs);
+        generateCanonicalCodeTable();
     }
 
-    // 生成编码表
-    void generateCodeTable() {
-        codeTable.clear();
-        generateCodesRecursive(root, "");
+    // 直接由码长表生成规范编码表
+    void buildFromCodeLengths(const CanonicalCode::Lengths& lengths) {
+        CanonicalCode::Codes codes = CanonicalCode::assign(lengths);
+        codeTableReady = false;
+        for (int symbol = 0; symbol < 256; symbol++) {
+            codeBits[symbol] = codes[symbol];
+            codeLengths[symbol] = lengths[symbol];
+        }
     }
 
-    // 获取编码表
+    // 获取编码表（字符串形式，按需由扁平编码表生成）
     const std::unordered_map<char, std::string>& getCodeTable() const {
+        if (!codeTableReady) {
+            codeTable.clear();
+            for (int symbol = 0; symbol < 256; symbol++) {
+                if (codeLengths[symbol] == 0) continue;
+                std::string code;
+                for (int i = codeLengths[symbol] - 1; i >= 0; i--) {
+                    code += ((codeBits[symbol] >> i) & 1) ? '1' : '0';
+                }
+                codeTable[static_cast<char>(symbol)] = code;
+            }
+            codeTableReady = true;
+        }
         return codeTable;
     }
 
-    // 获取树根节点
-    HuffmanNode* getRoot() const {
-        return root;
-    }
-
-    // 设置树根节点（用于反序列化）
-    void setRoot(HuffmanNode* newRoot) {
-        delete root;
-        root = newRoot;
+    // 树的节点（规范码长直接生成编码表时为空）
+    const HuffmanNodeArena& getNodes() const {
+        return nodes;
     }
 
-    // 释放根节点的所有权（用于序列化后转移所有权）
-    HuffmanNode* releaseRoot() {
-        HuffmanNode* temp = root;
-        root = nullptr;
-        return temp;
+    HuffmanNodeArena& getNodes() {
+        return nodes;
     }
 
     // 编码：将文本转换为哈夫曼编码位串
     std::string encode(const std::string& text) const {
+        const auto& table = getCodeTable();
         std::string encoded;
         for (char ch : text) {
-            auto it = codeTable.find(ch);
-            if (it != codeTable.end()) {
+            auto it = table.find(ch);
+            if (it != table.end()) {
                 encoded += it->second;
             } else {
                 std::cerr << "警告：字符 '" << ch << "' 不在编码表中" << std::endl;
@@ -110,82 +173,69 @@ public:
         return encoded;
     }
 
-    // 解码：将哈夫曼编码位串还原为文本
-    std::string decode(const std::string& encodedString) const {
-        if (root == nullptr) {
-            std::cerr << "错误：树根为空" << std::endl;
-            return "";
-        }
-
-        std::string decodedString;
-        HuffmanNode* current = root;
-
-        for (char bit : encodedString) {
-            // 根据当前位走左子树或右子树
-            if (bit == '0') {
-                current = current->left;
-            } else if (bit == '1') {
-                current = current->right;
-            } else {
-                std::cerr << "错误：编码字符串包含无效字符 '" << bit << "'" << std::endl;
-                return "";
-            }
-
-            // 检查是否到达叶子节点
-            if (current == nullptr) {
-                std::cerr << "错误：无效的编码路径" << std::endl;
-                return "";
-            }
-
-            if (current->isLeaf()) {
-                decodedString += current->character;
-                current = root; // 回到根节点继续解码
+    // 编码：把字节直接按码字写入位写入器，不经过'0'/'1'字符串
+    // Writer 为 PackedBitWriter 或 PackedBitSpanWriter
+    template <typename Writer>
+    void encodeTo(const char* data, size_t size, Writer& writer) const {
+        for (size_t i = 0; i < size; i++) {
+            unsigned char symbol = static_cast<unsigned char>(data[i]);
+            int length = codeLengths[symbol];
+            if (length == 0) {
+                std::cerr << "警告：字符 '" << data[i] << "' 不在编码表中" << std::endl;
+                continue;
             }
+            writer.writeBits(codeBits[symbol], length);
         }
+    }
 
-        // 检查是否正好结束在根节点（完整解码）
-        if (current != root) {
-            std::cerr << "警告：编码字符串不完整" << std::endl;
+    void encodeTo(const std::string& text, PackedBitWriter& writer) const {
+        encodeTo(text.data(), text.size(), writer);
+    }
+
+    // 按频率计算编码后的总位数（无需实际编码）
+    uint64_t encodedBitCount(const std::vector<std::pair<char, uint64_t>>& charFreqs) const {
+        uint64_t bits = 0;
+        for (const auto& pair : charFreqs) {
+            bits += pair.second * codeLengths[static_cast<unsigned char>(pair.first)];
         }
+        return bits;
+    }
 
-        return decodedString;
+    // 解码：将哈夫曼编码位串还原为文本
+    std::string decode(const std::string& encodedString) const {
+        return decodeWithTree(nodes, encodedString);
     }
 
-    // 静态方法：用于解压时直接用root解码（向后兼容）
-    static std::string decodeWithRoot(HuffmanNode* root, const std::string& encodedString) {
-        if (root == nullptr) {
+    // 静态方法：用于解压时直接用树解码（向后兼容）
+    static std::string decodeWithTree(const HuffmanNodeArena& tree, const std::string& encodedString) {
+        if (tree.empty()) {
             std::cerr << "错误：树根为空" << std::endl;
             return "";
         }
 
-        std::string decodedString;
-        HuffmanNode* current = root;
-
-        for (char bit : encodedString) {
-            if (bit == '0') {
-                current = current->left;
-            } else if (bit == '1') {
-                current = current->right;
-            } else {
+        // 先把'0'/'1'位串打包成字节，再交给查表解码器
+        std::vector<uint8_t> packed((encodedString.length() + 7) / 8, 0);
+        for (size_t i = 0; i < encodedString.length(); i++) {
+            char bit = encodedString[i];
+            if (bit == '1') {
+                packed[i / 8] |= static_cast<uint8_t>(0x80 >> (i % 8));
+            } else if (bit != '0') {
                 std::cerr << "错误：编码字符串包含无效字符 '" << bit << "'" << std::endl;
                 return "";
             }
-
-            if (current == nullptr) {
-                std::cerr << "错误：无效的编码路径" << std::endl;
-                return "";
-            }
-
-            if (current->isLeaf()) {
-                decodedString += current->character;
-                current = root;
-            }
         }
 
-        if (current != root) {
-            std::cerr << "警告：编码字符串不完整" << std::endl;
-        }
+        return decodeWithTree(tree, packed, encodedString.length());
+    }
 
+    // 静态方法：直接解码打包好的字节（前bitCount位有效）
+    static std::string decodeWithTree(const HuffmanNodeArena& tree, const std::vector<uint8_t>& packed,
+                                      uint64_t bitCount) {
+        HuffmanDecoder decoder(tree);
+        std::string decodedString;
+        if (!decoder.decode(packed, bitCount, decodedString)) {
+            return "";
+        }
         return decodedString;
     }
 
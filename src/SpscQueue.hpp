@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// 单生产者、单消费者的有界无锁队列：环形数组加两个原子下标
+// 用于连接流水线中相邻的两个阶段（恰好一个线程 push、一个线程 pop），
+// 阶段之间传递的是可复用缓冲区的指针，数据本身不拷贝
+// 队列满或空时先让出CPU，等待稍久就短暂休眠，不会长时间空转占满一个核
+template <typename T>
+class SpscQueue {
+private:
+    std::vector<T> slots;                   // 多留一个空位，用于区分满和空
+    alignas(64) std::atomic<size_t> head{0};  // 下一个读取位置，只由消费者修改
+    alignas(64) std::atomic<size_t> tail{0};  // 下一个写入位置，只由生产者修改
+
+    size_t advance(size_t index) const {
+        return index + 1 == slots.size() ? 0 : index + 1;
+    }
+
+    static void backoff(int& attempts) {
+        if (++attempts < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+public:
+    explicit SpscQueue(size_t capacity) : slots(capacity + 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    bool tryPush(const T& value) {
+        size_t current = tail.load(std::memory_order_relaxed);
+        size_t next = advance(current);
+        if (next == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        slots[current] = value;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        size_t current = head.load(std::memory_order_relaxed);
+        if (current == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = slots[current];
+        head.store(advance(current), std::memory_order_release);
+        return true;
+    }
+
+    // 阻塞直到放入
+    void push(const T& value) {
+        int attempts = 0;
+        while (!tryPush(value)) {
+            backoff(attempts);
+        }
+    }
+
+    // 阻塞直到取出
+    T pop() {
+        T value;
+        int attempts = 0;
+        while (!tryPop(value)) {
+            backoff(attempts);
+        }
+        return value;
+    }
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "CanonicalCode.hpp"
+#include "HuffmanTree.hpp"
+#include "HuffmanDecoder.hpp"
+#include <array>
+#include <cstdint>
+
+// 内置的静态码长表，供小块使用：小输入自带的码长表往往比它省下的位数还多，
+// 改用按数据类型预先生成的表，块中只记1字节表号
+// 各表覆盖全部256个字节值（任何输入都能编码），码长不超过11位（解码每个符号只查一次表）；
+// 由代表性语料的字节频率（每个字节值至少计1次）经 CanonicalCode::packageMerge 离线生成：
+// 文本取自英文许可证文本，JSON/日志取自 JSON 记录和常见格式的日志行，二进制取自 ELF 可执行文件
+// 表号写入压缩文件，已有的表不能再修改，只能追加
+class StaticTables {
+public:
+    enum Id : uint8_t {
+        kText = 0,
+        kJson = 1,
+        kBinary = 2,
+    };
+
+    static constexpr int kCount = 3;
+    static constexpr int kMaxLength = 11;  // 各表的最大码长
+
+    static constexpr std::array<CanonicalCode::Lengths, kCount> kLengths = {{
+        // 文本：英文散文、文档
+        {{
+            11,11,11,11,11,11,11,11,11,11,6,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
+            3,11,9,11,11,11,11,11,9,9,10,11,7,9,7,11,11,10,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
+            11,8,10,8,9,8,9,9,9,8,11,11,8,9,8,8,9,11,8,8,8,9,11,10,11,9,11,11,11,11,11,11,
+            11,4,7,5,6,4,6,7,5,4,11,8,6,6,4,4,6,10,4,5,4,6,7,7,9,6,11,11,11,11,11,11,
+            11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
+            11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
+            11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
+            11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11
+        }},
+        // JSON 记录和日志行
+        {{
+            11,11,11,11,11,11,11,11,11,11,6,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
+            3,11,4,11,11,11,11,11,11,11,11,11,5,7,6,10,5,5,5,6,6,6,7,7,7,7,5,11,11,9,11,11,
+            11,8,8,8,11,9,9,10,10,9,11,11,10,11,9,9,11,11,9,11,8,10,11,10,11,11,9,7,11,7,11,8,
+            11,5,7,6,6,4,8,8,7,6,11,9,6,6,6,5,6,10,5,5,5,6,8,9,10,8,11,8,11,8,11,11,
+            11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
+            11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
+            11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
+            11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11
+        }},
+        // 二进制：可执行文件等
+        {{
+            3,6,7,7,7,7,8,8,6,9,9,9,9,9,6,6,6,8,10,10,10,9,10,10,7,10,10,10,10,10,10,8,
+            7,10,10,11,5,9,11,11,8,8,11,10,10,10,9,10,8,8,11,11,10,9,11,11,8,7,10,10,10,9,11,10,
+            8,6,7,9,6,8,9,9,4,7,10,10,6,8,10,10,8,11,10,9,8,9,10,10,9,11,11,9,9,9,10,9,
+            9,9,10,9,9,8,8,10,9,9,11,10,8,10,9,8,7,11,9,9,6,8,10,10,9,10,11,10,8,10,10,10,
+            8,9,10,7,6,7,9,10,9,5,10,5,9,6,9,10,8,10,11,10,9,10,11,11,10,11,11,11,10,10,11,11,
+            9,11,11,11,10,11,11,11,10,11,10,11,10,11,11,11,9,11,11,11,9,10,9,10,9,10,9,10,8,9,9,10,
+            7,9,9,8,9,9,8,7,9,10,10,11,10,11,10,10,9,10,9,10,10,10,10,10,9,11,10,10,10,10,10,8,
+            9,10,10,10,10,10,10,9,6,7,10,8,9,9,9,8,9,10,10,9,10,10,9,9,8,10,9,9,9,8,8,4
+        }}
+    }};
+
+    // 表号对应的编码树，首次使用时构建，之后各线程共用
+    static const HuffmanTree& encoder(uint8_t id) {
+        return codecs().trees[id];
+    }
+
+    // 表号对应的解码表
+    static const HuffmanDecoder& decoder(uint8_t id) {
+        return codecs().decoders[id];
+    }
+
+private:
+    struct Codecs {
+        HuffmanTree trees[kCount];
+        HuffmanDecoder decoders[kCount];
+
+        Codecs() {
+            for (int id = 0; id < kCount; id++) {
+                trees[id].buildFromCodeLengths(kLengths[id]);
+                decoders[id].buildFromLengths(kLengths[id]);
+            }
+        }
+    };
+
+    static const Codecs& codecs() {
+        static const Codecs instance;
+        return instance;
+    }
+};
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define EASYCOMPRESS_POSIX_TIME 1
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
+// 运行统计（--stats=json）：各阶段耗时、字节数、峰值内存和每个文件的明细
+// 阶段计时由 Stats::Timer 在作用域内累加墙钟时间和本线程CPU时间；
+// 并行执行的阶段由各线程分别计时后相加，因此可能超过总耗时
+// 不统计时各处传入 nullptr，计时器什么也不做
+class Stats {
+public:
+    enum Phase {
+        kScan,       // 遍历目录、收集文件列表
+        kHistogram,  // 统计字节频率
+        kTreeBuild,  // 构建码长表
+        kEncode,     // 编码
+        kWrite,      // 写出
+        kRead,       // 读取压缩数据
+        kDecode,     // 解码
+        kPhaseCount
+    };
+
+    // 一个文件（文件夹压缩包中的条目）的明细
+    struct FileStats {
+        std::string path;
+        uint64_t bytesIn = 0;
+        uint64_t bytesOut = 0;
+        double seconds = 0;  // 处理这个文件的各阶段耗时之和
+    };
+
+    static constexpr size_t kSlowestCount = 10;  // 摘要中列出的最慢条目数
+
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    std::vector<FileStats> files;
+
+private:
+    struct PhaseTime {
+        std::atomic<uint64_t> wallNs{0};
+        std::atomic<uint64_t> cpuNs{0};
+    };
+
+    std::array<PhaseTime, kPhaseCount> phases;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    double processCpu = 0;
+
+    static const char* phaseName(int phase) {
+        static const char* const names[kPhaseCount] = {
+            "scan", "histogram", "tree_build", "encode", "write", "read", "decode"};
+        return names[phase];
+    }
+
+    // 当前线程已用的CPU时间（纳秒）
+    static uint64_t threadCpuNs() {
+#ifdef EASYCOMPRESS_POSIX_TIME
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+        return uint64_t(std::clock()) * 1000000000 / CLOCKS_PER_SEC;
+#endif
+    }
+
+    // 整个进程已用的CPU时间（秒，用户态加内核态）
+    static double processCpuSeconds() {
+#ifdef EASYCOMPRESS_POSIX_TIME
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+             + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#else
+        return double(std::clock()) / CLOCKS_PER_SEC;
+#endif
+    }
+
+    // 峰值常驻内存（字节），取不到时为0
+    static uint64_t peakRss() {
+#ifdef EASYCOMPRESS_POSIX_TIME
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return uint64_t(usage.ru_maxrss);          // macOS 以字节为单位
+#else
+        return uint64_t(usage.ru_maxrss) * 1024;   // Linux 以KB为单位
+#endif
+#else
+        return 0;
+#endif
+    }
+
+    static void writeString(std::ostream& out, const std::string& text) {
+        out << '"';
+        for (char ch : text) {
+            unsigned char c = static_cast<unsigned char>(ch);
+            if (ch == '"' || ch == '\\') {
+                out << '\\' << ch;
+            } else if (c < 0x20) {
+                static const char hex[] = "0123456789abcdef";
+                out << "\\u00" << hex[c >> 4] << hex[c & 15];
+            } else {
+                out << ch;
+            }
+        }
+        out << '"';
+    }
+
+    static void writeFile(std::ostream& out, const FileStats& file) {
+        out << "{\"path\": ";
+        writeString(out, file.path);
+        out << ", \"bytes_in\": " << file.bytesIn << ", \"bytes_out\": " << file.bytesOut
+            << ", \"seconds\": " << file.seconds << "}";
+    }
+
+public:
+    // 作用域计时器：析构时把这段时间计入阶段，并可同时累加到某个文件的耗时上
+    class Timer {
+    private:
+        Stats* stats;
+        Phase phase;
+        double* fileSeconds;
+        std::chrono::steady_clock::time_point wallStart;
+        uint64_t cpuStart = 0;
+
+    public:
+        Timer(Stats* stats, Phase phase, double* fileSeconds = nullptr)
+            : stats(stats), phase(phase), fileSeconds(fileSeconds) {
+            if (stats == nullptr) return;
+            wallStart = std::chrono::steady_clock::now();
+            cpuStart = threadCpuNs();
+        }
+
+        ~Timer() {
+            stop();
+        }
+
+        // 提前结束计时（之后析构不再重复计入）
+        void stop() {
+            if (stats == nullptr) return;
+            uint64_t wallNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - wallStart).count();
+            stats->phases[phase].wallNs += wallNs;
+            stats->phases[phase].cpuNs += threadCpuNs() - cpuStart;
+            if (fileSeconds != nullptr) *fileSeconds += wallNs / 1e9;
+            stats = nullptr;
+        }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+    };
+
+    // 记录总耗时和进程CPU时间，在输出前调用
+    void finish() {
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        processCpu = processCpuSeconds();
+    }
+
+    // 以JSON输出；operation 为 "compress" 或 "decompress"
+    void writeJson(std::ostream& out, const std::string& operation) const {
+        out << "{\n  \"operation\": ";
+        writeString(out, operation);
+        out << ",\n  \"wall_s\": " << elapsed << ",\n  \"cpu_s\": " << processCpu
+            << ",\n  \"bytes_in\": " << bytesIn << ",\n  \"bytes_out\": " << bytesOut
+            << ",\n  \"peak_rss_bytes\": " << peakRss();
+        if (elapsed > 0) {
+            out << ",\n  \"mb_per_s\": " << bytesIn / elapsed / 1e6;
+        }
+
+        out << ",\n  \"phases\": {";
+        bool firstPhase = true;
+        for (int phase = 0; phase < kPhaseCount; phase++) {
+            uint64_t wallNs = phases[phase].wallNs;
+            if (wallNs == 0) continue;  // 只输出这次实际经过的阶段
+            out << (firstPhase ? "\n" : ",\n") << "    \"" << phaseName(phase) << "\": {\"wall_s\": "
+                << wallNs / 1e9 << ", \"cpu_s\": " << phases[phase].cpuNs / 1e9 << "}";
+            firstPhase = false;
+        }
+        out << (firstPhase ? "}" : "\n  }");
+
+        if (!files.empty()) {
+            out << ",\n  \"file_count\": " << files.size();
+            if (elapsed > 0) {
+                out << ",\n  \"files_per_s\": " << files.size() / elapsed;
+            }
+
+            std::vector<const FileStats*> slowest;
+            for (const auto& file : files) slowest.push_back(&file);
+            size_t shown = std::min(kSlowestCount, slowest.size());
+            std::partial_sort(slowest.begin(), slowest.begin() + shown, slowest.end(),
+                              [](const FileStats* a, const FileStats* b) { return a->seconds > b->seconds; });
+            out << ",\n  \"slowest\": [";
+            for (size_t i = 0; i < shown; i++) {
+                out << (i == 0 ? "\n    " : ",\n    ");
+                writeFile(out, *slowest[i]);
+            }
+            out << "\n  ],\n  \"files\": [";
+            for (size_t i = 0; i < files.size(); i++) {
+                out << (i == 0 ? "\n    " : ",\n    ");
+                writeFile(out, files[i]);
+            }
+            out << "\n  ]";
+        }
+        out << "\n}" << std::endl;
+    }
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <algorithm>
+
+// 固定大小的线程池
+// 构造时传入总线程数，池中创建 threadCount-1 个工作线程，调用线程在 parallelFor 中也参与工作；
+// threadCount <= 1 时不创建线程，所有任务在调用线程中直接执行。
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping;
+
+    void workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t threadCount) : stopping(false) {
+        for (size_t i = 1; i < threadCount; i++) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // 参与计算的总线程数（含调用线程）
+    size_t size() const {
+        return workers.size() + 1;
+    }
+
+    // 提交一个任务；没有工作线程时直接执行
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F fn) {
+        using Result = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(fn));
+        std::future<Result> result = task->get_future();
+
+        if (workers.empty()) {
+            (*task)();
+            return result;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace([task] { (*task)(); });
+        }
+        condition.notify_one();
+        return result;
+    }
+
+    // 并行执行 fn(0) ... fn(count-1)，阻塞到全部完成
+    // 各线程从共享计数器动态领取下标，任务耗时不均时也能均衡负载
+    template <typename F>
+    void parallelFor(size_t count, F fn) {
+        if (workers.empty() || count <= 1) {
+            for (size_t i = 0; i < count; i++) {
+                fn(i);
+            }
+            return;
+        }
+
+        auto next = std::make_shared<std::atomic<size_t>>(0);
+        auto drain = [next, count, &fn] {
+            for (size_t i = (*next)++; i < count; i = (*next)++) {
+                fn(i);
+            }
+        };
+
+        size_t helpers = std::min(workers.size(), count - 1);
+        std::vector<std::future<void>> pending;
+        pending.reserve(helpers);
+        for (size_t i = 0; i < helpers; i++) {
+            pending.push_back(submit(drain));
+        }
+        drain();
+        for (auto& done : pending) {
+            done.get();
+        }
+    }
+
+    // 默认线程数：硬件并发数
+    static size_t defaultThreadCount() {
+        unsigned n = std::thread::hardware_concurrency();
+        return n == 0 ? 1 : n;
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+};
@@ -2,51 +2,212 @@
 
 #include "HuffmanNode.hpp"
 #include "BitStream.hpp"
+#include "CanonicalCode.hpp"
+#include <array>
 #include <fstream>
+#include <iostream>
 
 class TreeSerializer {
+private:
+    static constexpr int kInitialLength = 8;  // 码长差分编码的初始参考值
+
+    // Elias-gamma编码：写 (位数-1) 个0，再写value本身（value >= 1）
+    template <typename Writer>
+    static void writeGamma(Writer& writer, uint32_t value) {
+        int bits = 0;
+        while ((value >> bits) > 1) bits++;
+        for (int i = 0; i < bits; i++) {
+            writer.writeBit(0);
+        }
+        for (int i = bits; i >= 0; i--) {
+            writer.writeBit((value >> i) & 1);
+        }
+    }
+
+    // 读取Elias-gamma编码，失败返回0
+    template <typename Reader>
+    static uint32_t readGamma(Reader& reader) {
+        int zeros = 0;
+        int bit;
+        while ((bit = reader.readBit()) == 0) {
+            if (++zeros > 16) return 0;
+        }
+        if (bit < 0) return 0;
+
+        uint32_t value = 1;
+        for (int i = 0; i < zeros; i++) {
+            bit = reader.readBit();
+            if (bit < 0) return 0;
+            value = (value << 1) | bit;
+        }
+        return value;
+    }
+
 public:
-    // 序列化哈夫曼树到位流
-    static void serialize(HuffmanNode* root, BitWriter& writer) {
-        if (root == nullptr) {
+    // 序列化哈夫曼树到位流（先序：内部节点写1，叶子写0和字符）
+    // 用显式栈遍历，不递归
+    static void serialize(const HuffmanNodeArena& tree, BitWriter& writer) {
+        if (tree.empty()) {
             return;
         }
 
-        if (root->isLeaf()) {
-            writer.writeBit(0);  // 叶子节点标记
-            writer.writeByte(static_cast<unsigned char>(root->character));
-            return;
+        std::array<uint16_t, HuffmanNodeArena::kMaxNodes> stack;
+        size_t top = 0;
+        stack[top++] = tree.root();
+        while (top > 0) {
+            const HuffmanNode& node = tree[stack[--top]];
+            if (node.isLeaf()) {
+                writer.writeBit(0);  // 叶子节点标记
+                writer.writeByte(static_cast<unsigned char>(node.character));
+                continue;
+            }
+
+            // 内部节点：右子树先入栈，左子树先写出
+            writer.writeBit(1);  // 内部节点标记
+            if (node.right != HuffmanNode::kNone) stack[top++] = node.right;
+            if (node.left != HuffmanNode::kNone) stack[top++] = node.left;
         }
-        
-        // 内部节点
-        writer.writeBit(1);  // 内部节点标记
-        serialize(root->left, writer);
-        serialize(root->right, writer);
     }
 
-    // 从位流反序列化哈夫曼树
-    static HuffmanNode* deserialize(BitReader& reader) {
-        int bit = reader.readBit();
+    // 从位流反序列化哈夫曼树到 tree（会先清空）
+    // 栈中是还缺子节点的内部节点，新读到的节点挂在栈顶节点下；失败返回false
+    static bool deserialize(BitReader& reader, HuffmanNodeArena& tree) {
+        tree.clear();
+        std::array<uint16_t, HuffmanNodeArena::kMaxNodes> stack;
+        size_t top = 0;
 
-        if (bit == 0) {
-            // 叶子节点：读取字符
-            int ch = reader.readByte();
-            if (ch == -1) {
-                std::cerr << "错误：读取字符失败" << std::endl;
-                return nullptr;
+        do {
+            int bit = reader.readBit();
+            uint16_t index;
+            if (bit == 0) {
+                // 叶子节点：读取字符
+                int ch = reader.readByte();
+                if (ch == -1) {
+                    std::cerr << "错误：读取字符失败" << std::endl;
+                    tree.clear();
+                    return false;
+                }
+                index = tree.addLeaf(static_cast<char>(ch), 0);
+            } else if (bit == 1) {
+                // 内部节点：子节点随后读出
+                index = tree.addInternal(HuffmanNode::kNone, HuffmanNode::kNone, 0);
+            } else {
+                std::cerr << "错误：无效的位值 " << bit << std::endl;
+                tree.clear();
+                return false;
+            }
+            if (index == HuffmanNode::kNone) {
+                std::cerr << "错误：哈夫曼树节点过多" << std::endl;
+                tree.clear();
+                return false;
+            }
+
+            if (top == 0) {
+                tree.setRoot(index);
+            } else {
+                HuffmanNode& parent = tree[stack[top - 1]];
+                if (parent.left == HuffmanNode::kNone) {
+                    parent.left = index;
+                } else {
+                    parent.right = index;
+                    top--;  // 两个子节点都已读到
+                }
+            }
+            if (bit == 1) {
+                stack[top++] = index;
+            }
+        } while (top > 0);
+
+        return true;
+    }
+
+    // 序列化规范哈夫曼码长表（按字节值0..255顺序）：
+    //   '0' + gamma(n)          连续n个码长为0
+    //   '1' + '1' + gamma(n)    连续n个码长与前一个相同
+    //   '1' + gamma(zigzag(d)+1) 一个码长，与前一个非0码长相差d（d != 0）
+    template <typename Writer>
+    static void serializeLengths(const CanonicalCode::Lengths& lengths, Writer& writer) {
+        int previous = kInitialLength;
+        int i = 0;
+        while (i < 256) {
+            int run = 1;
+            while (i + run < 256 && lengths[i + run] == lengths[i]) run++;
+
+            if (lengths[i] == 0) {
+                writer.writeBit(0);
+                writeGamma(writer, run);
+                i += run;
+            } else if (lengths[i] == previous) {
+                writer.writeBit(1);
+                writeGamma(writer, 1);
+                writeGamma(writer, run);
+                i += run;
+            } else {
+                int delta = lengths[i] - previous;
+                uint32_t zigzag = delta > 0 ? 2 * delta : -2 * delta - 1;
+                writer.writeBit(1);
+                writeGamma(writer, zigzag + 1);
+                previous = lengths[i];
+                i++;
             }
-            return new HuffmanNode(static_cast<char>(ch), 0);
         }
-        else if (bit == 1) {
-            // 内部节点：递归读取左右子树
-            HuffmanNode* node = new HuffmanNode('\0', 0);
-            node->left = deserialize(reader);
-            node->right = deserialize(reader);
-            return node;
+    }
+
+    // 反序列化码长表，格式错误或码长不构成合法前缀码时返回false
+    template <typename Reader>
+    static bool deserializeLengths(Reader& reader, CanonicalCode::Lengths& lengths) {
+        lengths.fill(0);
+        int previous = kInitialLength;
+        int i = 0;
+        while (i < 256) {
+            int bit = reader.readBit();
+            if (bit < 0) {
+                std::cerr << "错误：码长表不完整" << std::endl;
+                return false;
+            }
+
+            if (bit == 0) {
+                uint32_t run = readGamma(reader);
+                if (run == 0 || i + run > 256) {
+                    std::cerr << "错误：码长表格式错误" << std::endl;
+                    return false;
+                }
+                i += run;
+                continue;
+            }
+
+            uint32_t token = readGamma(reader);
+            if (token == 0) {
+                std::cerr << "错误：码长表格式错误" << std::endl;
+                return false;
+            }
+            if (token == 1) {
+                uint32_t run = readGamma(reader);
+                if (run == 0 || i + run > 256) {
+                    std::cerr << "错误：码长表格式错误" << std::endl;
+                    return false;
+                }
+                for (uint32_t k = 0; k < run; k++) {
+                    lengths[i++] = static_cast<uint8_t>(previous);
+                }
+                continue;
+            }
+
+            uint32_t zigzag = token - 1;
+            int delta = (zigzag & 1) ? -static_cast<int>((zigzag + 1) / 2) : static_cast<int>(zigzag / 2);
+            int length = previous + delta;
+            if (length < 1 || length > CanonicalCode::kMaxCodeLength) {
+                std::cerr << "错误：码长超出范围" << std::endl;
+                return false;
+            }
+            lengths[i++] = static_cast<uint8_t>(length);
+            previous = length;
         }
-        else {
-            std::cerr << "错误：无效的位值 " << bit << std::endl;
-            return nullptr;
+
+        if (!CanonicalCode::isValid(lengths)) {
+            std::cerr << "错误：码长不构成合法前缀码" << std::endl;
+            return false;
         }
+        return true;
     }
 };
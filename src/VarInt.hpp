@@ -4,10 +4,14 @@
 #include <vector>
 #include <fstream>
 
+// 变长整数（LEB128）：每字节低7位为数据，最高位表示后面还有字节
+// 按64位编解码，最长10字节；小于2^32的值与原先32位版本的字节序列完全相同
 class VarInt {
 public:
-    // 编码：将uint32_t编码为变长字节序列
-    static std::vector<uint8_t> encode(uint32_t value) {
+    static constexpr int kMaxBytes = 10;
+
+    // 编码：将uint64_t编码为变长字节序列
+    static std::vector<uint8_t> encode(uint64_t value) {
         std::vector<uint8_t> bytes;
         
         while (value >= 0x80) {  // 128
@@ -22,9 +26,9 @@ public:
         return bytes;
     }
     
-    // 解码：从流中读取VarInt
-    static uint32_t decode(std::istream& in) {
-        uint32_t result = 0;
+    // 解码：从流中读取VarInt（超过10字节的部分被忽略）
+    static uint64_t decode(std::istream& in) {
+        uint64_t result = 0;
         int shift = 0;
         
         while (true) {
@@ -35,7 +39,9 @@ public:
             }
             
             // 取低7位，拼到结果中
-            result |= ((byte & 0x7F) << shift);
+            if (shift < 64) {
+                result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            }
             
             // 如果MSB=0，结束
             if ((byte & 0x80) == 0) {
@@ -49,13 +55,60 @@ public:
     }
     
     // 写入VarInt到流
-    static void write(std::ostream& out, uint32_t value) {
+    static void write(std::ostream& out, uint64_t value) {
         auto bytes = encode(value);
         out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
     }
     
+    // 追加VarInt到字节缓冲
+    static void append(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out.push_back(value & 0x7F);
+    }
+    
+    // 把VarInt写到p处并推进p，调用方须保证有 encodedSize(value) 字节的空间
+    static void put(uint8_t*& p, uint64_t value) {
+        while (value >= 0x80) {
+            *p++ = static_cast<uint8_t>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        *p++ = static_cast<uint8_t>(value & 0x7F);
+    }
+    
+    // 从内存中解码VarInt并推进p，数据不足或超长时返回false
+    static bool decode(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+        value = 0;
+        int shift = 0;
+        while (p < end && shift < 64) {
+            uint8_t byte = *p++;
+            // 第10字节只剩1位有效，更高的位会溢出64位
+            if (shift == 63 && (byte & 0x7E) != 0) {
+                return false;
+            }
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+            shift += 7;
+        }
+        return false;
+    }
+
+    // 解码到32位字段（块内长度等），值超出32位时视为损坏
+    static bool decode(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+        uint64_t wide;
+        if (!decode(p, end, wide) || wide > UINT32_MAX) {
+            return false;
+        }
+        value = static_cast<uint32_t>(wide);
+        return true;
+    }
+    
     // 计算编码后的字节数（不实际编码）
-    static size_t encodedSize(uint32_t value) {
+    static size_t encodedSize(uint64_t value) {
         size_t size = 0;
         while (value >= 0x80) {
             size++;
@@ -63,4 +116,47 @@ public:
         }
         return size + 1;
     }
+    
+    // 追加8字节小端定长整数（用于文件偏移等可能超过32位的字段）
+    static void appendFixed64(std::vector<uint8_t>& out, uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+    
+    // 读取8字节小端定长整数并推进p，数据不足时返回false
+    static bool decodeFixed64(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+        if (end - p < 8) return false;
+        value = 0;
+        for (int i = 0; i < 8; i++) {
+            value |= uint64_t(p[i]) << (8 * i);
+        }
+        p += 8;
+        return true;
+    }
+    
+    // 追加4字节小端定长整数（用于校验和）
+    static void appendFixed32(std::vector<uint8_t>& out, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+    
+    // 把4字节小端定长整数写到p处并推进p
+    static void putFixed32(uint8_t*& p, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            *p++ = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+    
+    // 读取4字节小端定长整数并推进p，数据不足时返回false
+    static bool decodeFixed32(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+        if (end - p < 4) return false;
+        value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= uint32_t(p[i]) << (8 * i);
+        }
+        p += 4;
+        return true;
+    }
 };
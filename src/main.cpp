@@ -1,8 +1,13 @@
 #include "FileCompressor.hpp"
 #include "FolderCompressor.hpp"
 #include "HuffmanTree.hpp"
+#include "CompressOptions.hpp"
+#include "Stats.hpp"
 #include <iostream>
 #include <filesystem>
+#include <string>
+#include <cstring>
+#include <charconv>
 
 namespace fs = std::filesystem;
 
@@ -11,6 +16,85 @@ void printTips(char* path)
     std::cout << "用法:" << std::endl;
     std::cout << "  压缩:   " << path << " -c <文件/文件夹>" << std::endl;
     std::cout << "  解压:   " << path << " -d <压缩文件>" << std::endl;
+    std::cout << "  测试:   " << path << " -t <压缩文件>   并行解码并核对校验和，不写出文件" << std::endl;
+    std::cout << "  列出:   " << path << " -l <文件夹压缩包>" << std::endl;
+    std::cout << "  提取:   " << path << " -x <文件夹压缩包> <包内路径>" << std::endl;
+    std::cout << "  更新:   " << path << " -u <文件夹>   只重新编码上次压缩后变化的文件" << std::endl;
+    std::cout << "  管道:   " << path << " -c - / -d -   从标准输入读取，结果写到标准输出" << std::endl;
+    std::cout << "选项:" << std::endl;
+    std::cout << "  -T <线程数>   并行线程数，0表示使用全部核心（默认）" << std::endl;
+    std::cout << "  --max-code-len <位数>   码长上限（1-32），解码表更小；默认不限制" << std::endl;
+    std::cout << "  --streams <数量>   单文件每块交错编码的子流数（1-" << BlockCodec::kMaxStreams
+              << "），默认4，解码时单核可同时推进多个子流" << std::endl;
+    std::cout << "  --stats=json   压缩/解压结束后以JSON输出各阶段耗时、峰值内存和每个文件的明细" << std::endl;
+    std::cout << "  --check-hash   更新时按内容哈希而不是修改时间判断文件是否变化" << std::endl;
+}
+
+// 把整个参数解析为十进制整数；含非数字字符或超出 int 范围时返回 false
+bool parseInt(const char* text, int& value)
+{
+    const char* end = text + std::strlen(text);
+    auto result = std::from_chars(text, end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+// 解析模式参数之后的选项和输入路径（-x 还有第二个路径）
+bool parseArguments(int argc, char* argv[], CompressOptions& options, std::string& inputPath,
+                    std::string& entryPath, bool& jsonStats)
+{
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-T" || arg == "--threads") {
+            if (i + 1 >= argc) {
+                std::cerr << "错误：" << arg << " 需要指定线程数" << std::endl;
+                return false;
+            }
+            int threads;
+            if (!parseInt(argv[++i], threads) || threads < 0) {
+                std::cerr << "错误：线程数无效" << std::endl;
+                return false;
+            }
+            options.threads = threads == 0 ? ThreadPool::defaultThreadCount() : static_cast<size_t>(threads);
+        } else if (arg == "--max-code-len") {
+            if (i + 1 >= argc) {
+                std::cerr << "错误：" << arg << " 需要指定位数" << std::endl;
+                return false;
+            }
+            int length;
+            if (!parseInt(argv[++i], length) || length < 1 || length > CanonicalCode::kMaxCodeLength) {
+                std::cerr << "错误：码长上限必须在 1-" << CanonicalCode::kMaxCodeLength << " 之间" << std::endl;
+                return false;
+            }
+            options.maxCodeLength = length;
+        } else if (arg == "--streams") {
+            if (i + 1 >= argc) {
+                std::cerr << "错误：" << arg << " 需要指定子流数" << std::endl;
+                return false;
+            }
+            int streams;
+            if (!parseInt(argv[++i], streams) || streams < 1 || streams > BlockCodec::kMaxStreams) {
+                std::cerr << "错误：子流数必须在 1-" << BlockCodec::kMaxStreams << " 之间" << std::endl;
+                return false;
+            }
+            options.streams = streams;
+        } else if (arg.rfind("--stats", 0) == 0) {
+            if (arg != "--stats=json") {
+                std::cerr << "错误：目前只支持 --stats=json" << std::endl;
+                return false;
+            }
+            jsonStats = true;
+        } else if (arg == "--check-hash") {
+            options.checkHash = true;
+        } else if (inputPath.empty()) {
+            inputPath = arg;
+        } else if (std::string(argv[1]) == "-x" && entryPath.empty()) {
+            entryPath = arg;
+        } else {
+            std::cerr << "错误：多余的参数 " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
 }
 
 int main(int argc, char* argv[])
@@ -18,68 +102,63 @@ int main(int argc, char* argv[])
     // 检查命令行参数
     if (argc > 1) {
         std::string mode = argv[1];
+        CompressOptions options;
+        std::string inputPath;
+        std::string entryPath;
+        bool jsonStats = false;
+        if (!parseArguments(argc, argv, options, inputPath, entryPath, jsonStats)) {
+            return 1;
+        }
+        
+        // -c - / -d -：标准输出用来传数据
+        bool streaming = inputPath == "-" &&
+            (mode == "-c" || mode == "--compress" || mode == "-d" || mode == "--decompress");
+
+        // --stats=json：标准输出只留给JSON，平时的进度信息改写到标准错误；管道模式下JSON也写到标准错误
+        Stats stats;
+        std::streambuf* stdoutBuffer = nullptr;
+        if (jsonStats) {
+            options.stats = &stats;
+        }
+        if (jsonStats || streaming) {
+            stdoutBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+        }
+        auto finish = [&](bool ok, const char* operation) {
+            if (stdoutBuffer != nullptr && !streaming) {
+                std::cout.rdbuf(stdoutBuffer);
+            }
+            if (jsonStats && ok) {
+                stats.finish();
+                stats.writeJson(std::cout, operation);
+            }
+            return ok ? 0 : 1;
+        };
         
         if (mode == "-c" || mode == "--compress") {
             // 压缩模式
-            if (argc < 3) {
+            if (inputPath.empty()) {
                 std::cerr << "错误：请指定要压缩的文件或文件夹" << std::endl;
                 std::cerr << "用法: " << argv[0] << " -c <文件/文件夹>" << std::endl;
                 return 1;
             }
-            std::string inputPath = argv[2];
             
+            if (streaming) {
+                // 从标准输入压缩到标准输出
+                std::ostream dataOut(stdoutBuffer);
+                return finish(FileCompressor::compressStream(std::cin, dataOut, options), "compress");
+            }
+
             // 检查是文件还是文件夹
             if (fs::is_directory(inputPath)) {
-                // 文件夹压缩：采用全局树和分离树两种方式压缩，保留较小的
-                std::cout << "正在压缩文件夹: " << inputPath << std::endl;
-                
-                // 统一去掉尾部斜杠
+                // 文件夹压缩：一次扫描比较全局树和单独树两种方案，只编码较小的
                 std::string folderPath = inputPath;
                 if (folderPath.back() == '/' || folderPath.back() == '\\') {
                     folderPath.pop_back();
                 }
-                std::string defaultOutput = folderPath + ".huf";
-                std::string globalTemp = folderPath + ".global.tmp.huf";
-                std::string separateTemp = folderPath + ".separate.tmp.huf";
-                
-                // 1. 压缩为全局树格式
-                std::cout << "正在生成全局树压缩" << std::endl;
-                if (!FolderCompressor::compressWithGlobalTree(folderPath)) {
-                    std::cerr << "全局树压缩失败" << std::endl;
-                    return 1;
-                }
-                // 重命名为临时文件
-                fs::rename(defaultOutput, globalTemp);
-                
-                // 2. 压缩为分离树格式
-                std::cout << "正在生成分离树压缩" << std::endl;
-                if (!FolderCompressor::compressWithSeparateTrees(folderPath)) {
-                    std::cerr << "分离树压缩失败" << std::endl;
-                    fs::remove(globalTemp);
-                    return 1;
-                }
-                // 重命名为临时文件
-                fs::rename(defaultOutput, separateTemp);
-                
-                // 3. 比较文件大小
-                auto globalSize = fs::file_size(globalTemp);
-                auto separateSize = fs::file_size(separateTemp);
-                
-                if (globalSize <= separateSize) {
-                    std::cout << "全局树更优 (" << globalSize << " B vs " << separateSize << " B)" << std::endl;
-                    fs::rename(globalTemp, defaultOutput);
-                    fs::remove(separateTemp);
-                } else {
-                    std::cout << "单独树更优 (" << separateSize << " B vs " << globalSize << " B)" << std::endl;
-                    fs::rename(separateTemp, defaultOutput);
-                    fs::remove(globalTemp);
-                }
-                
-                std::cout << "压缩完成: " << defaultOutput << std::endl;
-                return 0;
-            } else if (fs::is_regular_file(inputPath)) {
-                // 单文件压缩
-                return FileCompressor::compress(inputPath) ? 0 : 1;
+                return finish(FolderCompressor::compress(folderPath, options), "compress");
+            } else if (fs::exists(inputPath)) {
+                // 单文件压缩（普通文件之外也接受管道、设备等）
+                return finish(FileCompressor::compress(inputPath, options), "compress");
             } else {
                 std::cerr << "错误：" << inputPath << " 不是有效的文件或文件夹" << std::endl;
                 return 1;
@@ -87,12 +166,17 @@ int main(int argc, char* argv[])
         }
         else if (mode == "-d" || mode == "--decompress") {
             // 解压模式
-            if (argc < 3) {
+            if (inputPath.empty()) {
                 std::cerr << "错误：请指定要解压的文件" << std::endl;
                 std::cerr << "用法: " << argv[0] << " -d <压缩包.huf>" << std::endl;
                 return 1;
             }
-            std::string inputFile = argv[2];
+            if (streaming) {
+                // 从标准输入解压到标准输出
+                std::ostream dataOut(stdoutBuffer);
+                return finish(FileCompressor::decompressStream(std::cin, dataOut, options), "decompress");
+            }
+            std::string inputFile = inputPath;
             
             // 读取魔数判断格式
             std::ifstream file(inputFile, std::ios::binary);
@@ -105,17 +189,65 @@ int main(int argc, char* argv[])
             file.read(&magic, 1);
             file.close();
             
-            if (magic == 'F') {
+            if (magic == 'F' || magic == 'f') {
                 // 单文件格式
-                return FileCompressor::decompress(inputFile) ? 0 : 1;
-            } else if (magic == 'G' || magic == 'S') {
-                // 文件夹格式（全局树或单独树）
-                return FolderCompressor::decompress(inputFile) ? 0 : 1;
+                return finish(FileCompressor::decompress(inputFile, options), "decompress");
+            } else if (magic == 'G' || magic == 'S' || magic == 'g' || magic == 's' || magic == 'k') {
+                // 文件夹格式（全局树、单独树或分组树）
+                return finish(FolderCompressor::decompress(inputFile, options), "decompress");
             } else {
                 std::cerr << "错误：未知的文件格式（魔数: 0x" << std::hex << (int)(unsigned char)magic << "）" << std::endl;
                 return 1;
             }
         }
+        else if (mode == "-t" || mode == "--test") {
+            // 测试压缩文件是否完好
+            if (inputPath.empty()) {
+                std::cerr << "用法: " << argv[0] << " -t <压缩文件>" << std::endl;
+                return 1;
+            }
+            std::ifstream file(inputPath, std::ios::binary);
+            char magic = 0;
+            if (!file || !file.read(&magic, 1)) {
+                std::cerr << "错误：无法打开文件 " << inputPath << std::endl;
+                return 1;
+            }
+            file.close();
+            
+            if (magic == 'F' || magic == 'f') {
+                return finish(FileCompressor::test(inputPath, options), "test");
+            } else {
+                return finish(FolderCompressor::test(inputPath, options), "test");
+            }
+        }
+        else if (mode == "-u" || mode == "--update") {
+            // 增量更新文件夹压缩包
+            if (inputPath.empty() || !fs::is_directory(inputPath)) {
+                std::cerr << "用法: " << argv[0] << " -u <文件夹>" << std::endl;
+                return 1;
+            }
+            std::string folderPath = inputPath;
+            if (folderPath.back() == '/' || folderPath.back() == '\\') {
+                folderPath.pop_back();
+            }
+            return finish(FolderCompressor::update(folderPath, options), "update");
+        }
+        else if (mode == "-l" || mode == "--list") {
+            // 列出文件夹压缩包的内容
+            if (inputPath.empty()) {
+                std::cerr << "用法: " << argv[0] << " -l <文件夹压缩包>" << std::endl;
+                return 1;
+            }
+            return FolderCompressor::list(inputPath) ? 0 : 1;
+        }
+        else if (mode == "-x" || mode == "--extract") {
+            // 从文件夹压缩包中只解压一个文件
+            if (inputPath.empty() || entryPath.empty()) {
+                std::cerr << "用法: " << argv[0] << " -x <文件夹压缩包> <包内路径>" << std::endl;
+                return 1;
+            }
+            return FolderCompressor::extract(inputPath, entryPath) ? 0 : 1;
+        }
         else {
             std::cout << "未知参数: " << mode << std::endl;
             printTips(argv[0]);